@@ -0,0 +1,209 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Sermet Pekin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "dataframe.h"
+#include "url_builder.h"
+
+namespace evds
+{
+
+    // .................................................................. SeriesQuery
+    // one index group the user asked for, e.g. "TP.DK.USD.A-TP.DK.EUR.A"
+    struct SeriesQuery
+    {
+        std::string index;
+        Config config;
+    };
+
+    // .................................................................. Batch
+    /*
+    Several queries served by one multi-series request.
+    index   : the merged codes joined with "-", what goes to UrlBuilder
+    members : positions of the queries in the planned list
+    */
+    struct Batch
+    {
+        std::string index;
+        std::vector<size_t> members;
+        Config config;
+    };
+
+    // queries with the same key can share one URL
+    std::string batch_key(const Config &config)
+    {
+        std::vector<std::string> v = {config.start_date, config.end_date, config.frequency, config.formulas, config.aggregation};
+        return evds::join(v, "|");
+    }
+
+    bool is_datagroup(const std::string &index)
+    {
+        return index.find("bie_") != std::string::npos;
+    }
+
+    std::vector<std::string> series_codes(const std::string &index)
+    {
+        return evds::Index(index).get_v();
+    }
+
+    // "TP.DK" for "TP.DK.USD.A": series of one family share their native frequency
+    std::string series_family(const std::string &code)
+    {
+        auto first = code.find('.');
+        auto second = first == std::string::npos ? first : code.find('.', first + 1);
+        return code.substr(0, second);
+    }
+
+    /*
+    batch_key, plus the series families when the frequency is default: the
+    native frequencies are not known here, and a merged request over series
+    of different frequencies comes back on the union of their dates.
+    */
+    std::string merge_key(const Config &config, const std::vector<std::string> &codes)
+    {
+        std::string key = batch_key(config);
+        if (config.frequency != "default")
+            return key;
+
+        std::vector<std::string> families;
+        for (const auto &code : codes)
+            families.push_back(series_family(code));
+        std::sort(families.begin(), families.end());
+        families.erase(std::unique(families.begin(), families.end()), families.end());
+
+        return key + "|" + evds::join(families, ",");
+    }
+
+    // .................................................................. plan_batches
+    /*
+    Greedily merges compatible queries, in the order given, as long as the
+    URL of the merged request stays within max_url_length. Datagroups
+    (bie_...) cannot be combined and always get a batch of their own. At
+    the default frequency only queries of the same series families merge
+    (see merge_key).
+
+        plan_batches({{"TP.DK.USD.A", c}, {"TP.DK.EUR.A", c}}, 2000)
+        => one Batch {"TP.DK.USD.A-TP.DK.EUR.A", {0, 1}}
+    */
+    std::vector<Batch> plan_batches(const std::vector<SeriesQuery> &queries, size_t max_url_length)
+    {
+        std::vector<Batch> batches;
+        std::map<std::string, size_t> open_batches; // batch_key -> batch still accepting members
+
+        auto url_length = [](const std::vector<std::string> &codes, const Config &config)
+        {
+            return evds::UrlBuilder(evds::Index(codes), config).build().size();
+        };
+
+        std::vector<std::vector<std::string>> batch_codes;
+
+        for (size_t i = 0; i < queries.size(); ++i)
+        {
+            const auto &query = queries[i];
+
+            if (is_datagroup(query.index))
+            {
+                batches.push_back(Batch{query.index, {i}, query.config});
+                batch_codes.push_back({});
+                continue;
+            }
+
+            auto codes = series_codes(query.index);
+            std::string key = merge_key(query.config, codes);
+
+            auto it = open_batches.find(key);
+            if (it != open_batches.end())
+            {
+                auto merged = batch_codes[it->second];
+                for (const auto &code : codes)
+                {
+                    if (std::find(merged.begin(), merged.end(), code) == merged.end())
+                        merged.push_back(code);
+                }
+
+                if (url_length(merged, query.config) <= max_url_length)
+                {
+                    Batch &batch = batches[it->second];
+                    batch.members.push_back(i);
+                    batch.index = evds::join(merged, Index_delimiter);
+                    batch_codes[it->second] = std::move(merged);
+                    continue;
+                }
+            }
+
+            open_batches[key] = batches.size();
+            batches.push_back(Batch{evds::join(codes, Index_delimiter), {i}, query.config});
+            batch_codes.push_back(std::move(codes));
+        }
+
+        return batches;
+    }
+
+    // .................................................................. split_frame
+    /*
+    Columns of a merged response that belong to the given codes.
+    Series columns are named after the code with '.' -> '_', optionally
+    followed by a formula suffix ("TP_DK_USD_A-1"). Columns that are not
+    series of the batch (Tarih, YEARWEEK ...) go to every part. Every row
+    is kept: plan_batches only merges series that share their dates, and
+    empty rows (holidays) are part of the series' own response as well.
+    */
+    DataFrame split_frame(const DataFrame &df, const std::vector<std::string> &codes, const std::vector<std::string> &batch_codes)
+    {
+        auto owner = [](const std::string &column, const std::vector<std::string> &candidates) -> bool
+        {
+            for (const auto &code : candidates)
+            {
+                std::string clean = code;
+                std::replace(clean.begin(), clean.end(), '.', '_');
+
+                if (column == clean || column.rfind(clean + "-", 0) == 0)
+                    return true;
+            }
+            return false;
+        };
+
+        DataFrame part;
+        for (const auto &[name, column] : df.columns)
+        {
+            if (owner(name, codes) || !owner(name, batch_codes))
+            {
+                part.columns[name] = column;
+                if (df.column_types.count(name))
+                    part.column_types[name] = df.column_types.at(name);
+            }
+        }
+        return part;
+    }
+
+}
@@ -26,6 +26,7 @@
  * SOFTWARE.
  */
 
+#pragma once
 
 #include <iostream>
 #include <fstream>
@@ -33,94 +34,1029 @@
 #include <string>
 #include <filesystem>
 #include <functional>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 
-class Cache
+#include <zlib.h>
+
+#include "murmur_hash.h"
+
+// ...................................................... CacheStats
+struct CacheStats
 {
+    size_t entries = 0;
+    uint64_t raw_bytes = 0;    // live entries, uncompressed
+    uint64_t stored_bytes = 0; // live entries as written, headers and keys included
+    uint64_t dead_bytes = 0;   // superseded records waiting for compaction
+    uint64_t budget_bytes = 0; // 0 : unbounded
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evicted = 0;
+
+    double ratio() const
+    {
+        return stored_bytes > 0 ? static_cast<double>(raw_bytes) / stored_bytes : 0;
+    }
+
+    std::string str() const
+    {
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(1)
+            << "[cache] entries: " << entries << " raw: " << raw_bytes / 1048576.0 << " MB"
+            << " stored: " << stored_bytes / 1048576.0 << " MB ratio: " << std::setprecision(2) << ratio()
+            << " hits: " << hits << " misses: " << misses;
+        if (budget_bytes > 0)
+            oss << std::setprecision(1) << " budget: " << budget_bytes / 1048576.0 << " MB evicted: " << evicted;
+        return oss.str();
+    }
+};
+
+// ...................................................... EntryMeta
+/*
+Kept with every record for the freshness policy (freshness.h): when the
+data was fetched, the frequency it was asked with and its last
+observation. Records written before carry none, fetched_at 0.
+*/
+struct EntryMeta
+{
+    static constexpr int32_t unknown_day = INT32_MIN;
+
+    int64_t fetched_at = 0;                 // unix seconds
+    int32_t last_observation = unknown_day; // days since 01-01-1970
+    uint32_t frequency = 0;                 // EVDS frequency code, 0 : default
+
+    static EntryMeta now()
+    {
+        EntryMeta meta;
+        meta.fetched_at = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        return meta;
+    }
+};
+
+// ...................................................... PackFile
+/*
+Append-only store behind Cache, one per directory:
+
+<dir>/cache.pack : records, each a RecordHeader, the key and the data.
+                   Saving a key again appends a new record, the old one
+                   stays until compact().
+<dir>/cache.idx  : snapshot of the index (key hash -> newest record)
+                   and of the pack length it covers.
+
+Keys are hashed with MurmurHash3 x64 128, which unlike std::hash is the
+same with every compiler and standard library, so a pack and its index
+can be copied between machines.
+
+The index lives in memory, lookups are one hash map probe plus one read
+at a known offset. open() loads cache.idx and scans only the records
+appended after the snapshot, or the whole pack when the snapshot is
+missing or was written with another hash function. A record cut short
+by a crash ends the scan and is truncated away.
+
+Data is zlib compressed at Z_BEST_SPEED unless that does not make it
+smaller. The codec is part of every record ("EVPM" records carry a
+CodecHeader and an EntryMeta, "EVPC" records from before only the
+CodecHeader, "EVPK" records are plain), so entries written with any
+codec keep loading. load_stream() inflates piece by piece into
+a callback, the whole body never needs to be in memory.
 
+Records keep the full key, a hash hit with a different key is a miss.
+Superseded records are reclaimed by compact(), which save() runs once
+they take more than half of the pack (and at least compact_min_bytes).
+Meant for one writing process per directory.
+
+With set_budget() the live entries are kept within a byte budget by
+evicting the least recently used ones (erase()). Every entry has an
+access stamp, milliseconds of its last load or save, kept in cache.idx
+across runs. Eviction is incremental: each save() drops at most
+evict_batch entries, so no call waits for a large clean-up and loads
+never evict. Over budget, compaction already runs once the dead
+records pass a quarter of the budget, which keeps the pack file near
+1.25 times the budget.
+*/
+class PackFile
+{
 public:
-    Cache(const std::string &cache_dir, bool verbosein) : cache_dir_(cache_dir), verbose(verbosein)
+    enum class Codec : uint32_t
     {
+        none = 0,
+        zlib = 1,
+        tombstone = 0xFFFFFFFF // erase(): the key has no entry from here on
+    };
+
+    using Sink = std::function<void(const char *, size_t)>;
 
-        std::filesystem::create_directories(cache_dir_);
+    static constexpr uint64_t compact_min_bytes = 16 << 20;
+    static constexpr size_t compress_min_bytes = 256;
+    static constexpr size_t evict_batch = 8;
+
+    static std::shared_ptr<PackFile> open(const std::string &dir)
+    {
+        static std::mutex mutex;
+        static std::map<std::string, std::shared_ptr<PackFile>> packs;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto &pack = packs[dir];
+        if (!pack)
+            pack = std::make_shared<PackFile>(dir);
+        return pack;
     }
 
-    Cache()
+    // a private instance, open() shares one per directory
+    explicit PackFile(const std::string &dir) : dir_(dir)
     {
+        std::filesystem::create_directories(dir_);
+        remove_legacy_files();
+        if (!std::filesystem::exists(pack_path()))
+            std::ofstream(pack_path(), std::ios::binary);
+
+        uint64_t covered = read_index();
+        pack_size_ = std::filesystem::file_size(pack_path());
+        if (covered > pack_size_)
+        {
+            index_.clear();
+            covered = 0;
+        }
+
+        for (const auto &[key_hash, entry] : index_)
+            count_live(entry, 1);
+        dead_bytes_ = covered - std::min(covered, live_bytes_);
+        rebuild_lru();
 
-        std::filesystem::create_directories(cache_dir_);
+        open_file();
+        uint64_t end = scan(covered);
+        if (end < pack_size_)
+        {
+            std::cerr << "[cache] dropping a damaged record at the end of " << pack_path() << std::endl;
+            file_.close();
+            std::filesystem::resize_file(pack_path(), end);
+            pack_size_ = end;
+            open_file();
+        }
     }
 
-    template <typename... Args>
-    bool check_and_load_cache(const std::string &function_name, std::string &result, const Args &...args)
+    PackFile(const PackFile &) = delete;
+    PackFile &operator=(const PackFile &) = delete;
+
+    ~PackFile()
+    {
+        wait_for_compaction();
+        try
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            write_index();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    // codec for the records written from now on
+    void set_codec(Codec codec)
     {
-        std::string hash = generate_hash(function_name, args...);
-        std::string file_path = get_cache_file_path(hash);
+        std::lock_guard<std::mutex> lock(mutex_);
+        codec_ = codec;
+    }
 
-        if (std::filesystem::exists(file_path))
+    // byte budget of the live entries, 0 : unbounded. Applied by the next saves
+    void set_budget(uint64_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        budget_ = bytes;
+    }
+
+    bool load(const std::string &key, std::string &data)
+    {
+        std::string out;
+        if (!load_stream(key, [&out](const char *p, size_t n)
+                         { out.append(p, n); }))
+            return false;
+
+        data = std::move(out);
+        return true;
+    }
+
+    /*
+    Hands the data of key to sink in pieces as it is inflated, false when
+    there is no such entry. The stored bytes are read under the lock, the
+    sink runs after it is released. An entry that turns out to be damaged
+    halfway throws, sink may already have seen part of it.
+    */
+    bool load_stream(const std::string &key, const Sink &sink)
+    {
+        Record record;
+        std::string stored;
         {
-            result = load_cache(file_path);
-            return true;
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = index_.find(hash(key));
+            if (it == index_.end() || !read_record(it->second.offset, record) || record.key != key)
+            {
+                ++misses_;
+                return false;
+            }
+
+            stored.resize(record.data_size);
+            if (!file_.read(stored.data(), stored.size()))
+                throw std::runtime_error("Could not read cache file " + pack_path());
+
+            ++hits_;
+            touch(it->first, it->second);
         }
 
-        return false;
+        switch (record.codec)
+        {
+        case Codec::none:
+            copy_data(stored, sink);
+            break;
+        case Codec::zlib:
+            inflate_data(stored, sink);
+            break;
+        default:
+            throw std::runtime_error("Unknown codec in cache file " + pack_path());
+        }
+        return true;
     }
 
-    template <typename... Args>
-    void save_cache(const std::string &function_name, const std::string &data, const Args &...args)
+    // metadata of the entry of key, without reading its data
+    std::optional<EntryMeta> meta(const std::string &key)
     {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Record record;
+        auto it = index_.find(hash(key));
+        if (it == index_.end() || !read_record(it->second.offset, record) || record.key != key)
+            return std::nullopt;
+        return record.meta;
+    }
 
-        std::string hash = generate_hash(function_name, args...);
-        std::string file_path = get_cache_file_path(hash);
-        save_to_file(file_path, data);
-        if (verbose)
-            std::cout << "[saving cache] " << file_path << "\n";
+    void save(const std::string &key, const std::string &data, const EntryMeta &meta = EntryMeta::now())
+    {
+        bool wasteful = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            Codec codec = Codec::none;
+            std::string packed;
+            if (codec_ == Codec::zlib && data.size() >= compress_min_bytes)
+            {
+                packed = deflate_data(data);
+                if (packed.size() < data.size())
+                    codec = Codec::zlib;
+            }
+            const std::string &stored = codec == Codec::none ? data : packed;
+
+            Entry entry = append(key, codec, stored, data.size(), meta);
+            add(hash(key), entry);
+            evict();
+            maybe_write_index();
+            wasteful = needs_compaction();
+        }
+        if (wasteful)
+            compact_in_background();
+    }
+
+    // drops the entry of key, a tombstone record keeps it dropped after a restart
+    bool erase(const std::string &key)
+    {
+        bool wasteful = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = index_.find(hash(key));
+            if (it == index_.end())
+                return false;
+
+            drop(it, key);
+            wasteful = needs_compaction();
+        }
+        if (wasteful)
+            compact_in_background();
+        return true;
+    }
+
+    /*
+    compact() on a thread of its own: saves are made from FetchLoop
+    callbacks, which must not copy the pack. One at a time, a call while
+    one runs does nothing.
+    */
+    void compact_in_background()
+    {
+        std::lock_guard<std::mutex> lock(compactor_mutex_);
+        if (compactor_busy_)
+            return;
+        if (compactor_.joinable())
+            compactor_.join();
+
+        compactor_busy_ = true;
+        compactor_ = std::thread([this]
+                                 {
+            try
+            {
+                compact();
+            }
+            catch (const std::exception &ex)
+            {
+                std::cerr << "[cache] " << ex.what() << std::endl;
+            }
+            compactor_busy_ = false; });
+    }
+
+    void wait_for_compaction()
+    {
+        std::lock_guard<std::mutex> lock(compactor_mutex_);
+        if (compactor_.joinable())
+            compactor_.join();
+    }
+
+    /*
+    Rewrites the pack with the newest record of every key only. The live
+    records are copied to a new pack without the lock, lookups and saves go
+    on meanwhile. Under the lock, only the records appended since then are
+    copied and the new pack and index take over.
+    */
+    void compact()
+    {
+        std::vector<std::pair<evds::Hash128, Entry>> entries;
+        uint64_t end = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (compacting_)
+                return;
+            compacting_ = true;
+            entries.assign(index_.begin(), index_.end());
+            end = pack_size_;
+        }
+
+        try
+        {
+            compact_from(std::move(entries), end);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            compacting_ = false;
+            throw;
+        }
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return index_.size();
+    }
+
+    uint64_t dead_bytes()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return dead_bytes_;
+    }
+
+    CacheStats stats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        CacheStats s;
+        s.entries = index_.size();
+        s.raw_bytes = raw_bytes_;
+        s.stored_bytes = live_bytes_;
+        s.dead_bytes = dead_bytes_;
+        s.budget_bytes = budget_;
+        s.hits = hits_;
+        s.misses = misses_;
+        s.evicted = evicted_;
+        return s;
+    }
+
+    std::string pack_path() const
+    {
+        return dir_ + "/cache.pack";
     }
 
 private:
-    std::string cache_dir_ = "./.caches";
-    bool verbose = true;
+    static constexpr uint32_t record_magic = 0x4b505645;       // "EVPK", data as is
+    static constexpr uint32_t codec_record_magic = 0x43505645; // "EVPC", CodecHeader follows
+    static constexpr uint32_t meta_record_magic = 0x4d505645;  // "EVPM", CodecHeader and EntryMeta follow
+    static constexpr uint32_t index_magic = 0x58495645;        // "EVIX"
+    static constexpr size_t chunk_bytes = 64 * 1024;
+    static constexpr std::chrono::seconds index_flush_interval{1};
 
-    template <typename... Args>
-    std::string generate_hash(const std::string &function_name, const Args &...args) const
+    struct RecordHeader
     {
-        std::stringstream ss;
-        ss << function_name;
-        (void)(ss << ... << args);
-        return std::to_string(std::hash<std::string>{}(ss.str()));
+        uint32_t magic;
+        uint32_t key_size;
+        uint64_t data_size; // as stored
+    };
+
+    struct CodecHeader
+    {
+        uint32_t codec;
+        uint32_t reserved;
+        uint64_t raw_size;
+    };
+
+    struct Record
+    {
+        Codec codec = Codec::none;
+        uint64_t data_size = 0;
+        uint64_t raw_size = 0;
+        uint64_t size = 0; // whole record
+        EntryMeta meta;
+        std::string key;
+    };
+
+    struct Entry
+    {
+        uint64_t offset;
+        uint64_t size;        // whole record
+        uint64_t raw_size;    // data before compression
+        uint64_t last_access; // access stamp, see access_stamp()
+    };
+
+    // least recently used first
+    struct LruOrder
+    {
+        bool operator()(const std::pair<uint64_t, evds::Hash128> &a, const std::pair<uint64_t, evds::Hash128> &b) const
+        {
+            return std::tie(a.first, a.second.h1, a.second.h2) < std::tie(b.first, b.second.h1, b.second.h2);
+        }
+    };
+
+    struct IndexHeader
+    {
+        uint32_t magic;
+        uint32_t entry_size;
+        uint64_t hash_check; // hash of a fixed string, the hash function must not change
+        uint64_t covered;    // pack length the entries describe
+        uint64_t count;
+    };
+
+    std::mutex mutex_;
+    std::string dir_;
+    std::fstream file_;
+    std::unordered_map<evds::Hash128, Entry, evds::Hash128Hasher> index_;
+    std::set<std::pair<uint64_t, evds::Hash128>, LruOrder> lru_;
+    Codec codec_ = Codec::zlib;
+    uint64_t budget_ = 0;
+    uint64_t last_stamp_ = 0;
+    size_t evicted_ = 0;
+    uint64_t pack_size_ = 0;
+    uint64_t live_bytes_ = 0;
+    uint64_t raw_bytes_ = 0;
+    uint64_t dead_bytes_ = 0;
+    bool compacting_ = false;
+    std::mutex compactor_mutex_;
+    std::thread compactor_;
+    std::atomic<bool> compactor_busy_{false};
+    std::chrono::steady_clock::time_point index_written_ = std::chrono::steady_clock::now();
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+
+    static evds::Hash128 hash(const std::string &key)
+    {
+        return evds::murmur3_128(key);
     }
 
-    std::string get_cache_file_path(const std::string &hash) const
+    std::string index_path() const
     {
-        return cache_dir_ + "/" + hash + ".cache";
+        return dir_ + "/cache.idx";
     }
 
-    std::string load_cache(const std::string &file_path) const
+    // per-entry <hash>.cache files of the old layout: named by a hash of the key only, they cannot be migrated
+    void remove_legacy_files()
     {
+        size_t removed = 0;
+        std::error_code ec;
+        for (const auto &file : std::filesystem::directory_iterator(dir_, ec))
+        {
+            if (file.path().extension() == ".cache" && file.is_regular_file(ec) && std::filesystem::remove(file.path(), ec))
+                ++removed;
+        }
+        if (removed > 0)
+            std::cerr << "[cache] removed " << removed << " entries of the old one-file-per-entry layout from " << dir_
+                      << std::endl;
+    }
 
-        if (verbose)
-            std::cout << "[loading cache] " << file_path << "\n";
+    void open_file()
+    {
+        file_.open(pack_path(), std::ios::in | std::ios::out | std::ios::binary);
+        if (!file_)
+            throw std::runtime_error("Could not open cache file " + pack_path());
+    }
+
+    Entry append(const std::string &key, Codec codec, const std::string &stored, uint64_t raw_size, const EntryMeta &meta)
+    {
+        RecordHeader header{meta_record_magic, static_cast<uint32_t>(key.size()), stored.size()};
+        CodecHeader codec_header{static_cast<uint32_t>(codec), 0, raw_size};
+
+        std::string record(reinterpret_cast<const char *>(&header), sizeof(header));
+        record.append(reinterpret_cast<const char *>(&codec_header), sizeof(codec_header));
+        record.append(reinterpret_cast<const char *>(&meta), sizeof(meta));
+        record += key;
+        record += stored;
 
-        std::ifstream file(file_path, std::ios::in | std::ios::binary);
-        if (!file)
+        file_.clear();
+        file_.seekp(0, std::ios::end);
+        uint64_t offset = static_cast<uint64_t>(file_.tellp());
+        file_.write(record.data(), record.size());
+        file_.flush();
+        if (!file_)
+            throw std::runtime_error("Could not write cache file " + pack_path());
+
+        pack_size_ = offset + record.size();
+        return Entry{offset, record.size(), raw_size, 0};
+    }
+
+    bool needs_compaction() const
+    {
+        return !compacting_ && ((dead_bytes_ > compact_min_bytes && dead_bytes_ > live_bytes_) ||
+                                (budget_ > 0 && pack_size_ > budget_ && dead_bytes_ > budget_ / 4));
+    }
+
+    // saves the index with the access stamps now and then, a crash loses at most index_flush_interval of them
+    void maybe_write_index()
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (now - index_written_ < index_flush_interval)
+            return;
+
+        write_index();
+        index_written_ = now;
+    }
+
+    // milliseconds since the epoch, strictly increasing within a run
+    uint64_t access_stamp()
+    {
+        uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        last_stamp_ = std::max(now, last_stamp_ + 1);
+        return last_stamp_;
+    }
+
+    void touch(const evds::Hash128 &key_hash, Entry &entry)
+    {
+        lru_.erase({entry.last_access, key_hash});
+        entry.last_access = access_stamp();
+        lru_.insert({entry.last_access, key_hash});
+    }
+
+    void rebuild_lru()
+    {
+        lru_.clear();
+        for (const auto &[key_hash, entry] : index_)
         {
-            throw std::runtime_error("Could not open cache file for reading");
+            lru_.insert({entry.last_access, key_hash});
+            last_stamp_ = std::max(last_stamp_, entry.last_access);
         }
+    }
 
-        std::string data((std::istreambuf_iterator<char>(file)),
-                         std::istreambuf_iterator<char>());
-        file.close();
-        return data;
+    // removes the entry behind it, a tombstone keeps it removed after a restart
+    void drop(std::unordered_map<evds::Hash128, Entry, evds::Hash128Hasher>::iterator it, const std::string &key)
+    {
+        Entry tombstone = append(key, Codec::tombstone, "", 0, EntryMeta::now());
+        lru_.erase({it->second.last_access, it->first});
+        remove(it->second);
+        index_.erase(it);
+        dead_bytes_ += tombstone.size;
+    }
+
+    // least recently used entries out while over budget, at most evict_batch per call.
+    // The newest entry stays even when it alone is over budget
+    void evict()
+    {
+        for (size_t n = 0; n < evict_batch && budget_ > 0 && live_bytes_ > budget_ && lru_.size() > 1; ++n)
+        {
+            auto it = index_.find(lru_.begin()->second);
+            Record record;
+            if (it == index_.end() || !read_record(it->second.offset, record))
+            {
+                lru_.erase(lru_.begin());
+                continue;
+            }
+
+            drop(it, record.key);
+            ++evicted_;
+        }
+    }
+
+    // entry no longer live, its bytes wait for compaction
+    void remove(const Entry &entry)
+    {
+        count_live(entry, -1);
+        dead_bytes_ += entry.size;
+    }
+
+    void count_live(const Entry &entry, int sign)
+    {
+        live_bytes_ += sign * entry.size;
+        raw_bytes_ += sign * entry.raw_size;
+    }
+
+    void add(const evds::Hash128 &key_hash, Entry entry)
+    {
+        if (entry.last_access == 0)
+            entry.last_access = access_stamp();
+
+        auto [it, inserted] = index_.try_emplace(key_hash, entry);
+        if (!inserted)
+        {
+            lru_.erase({it->second.last_access, it->first});
+            remove(it->second);
+            it->second = entry;
+        }
+        lru_.insert({entry.last_access, key_hash});
+        count_live(entry, 1);
     }
 
-    void save_to_file(const std::string &file_path, const std::string &data) const
+    // reads header and key, the file is left at the start of the data
+    bool read_record(uint64_t offset, Record &record)
     {
-        std::ofstream file(file_path, std::ios::out | std::ios::binary);
-        if (!file)
+        RecordHeader header;
+        file_.clear();
+        file_.seekg(static_cast<std::streamoff>(offset));
+        if (!file_.read(reinterpret_cast<char *>(&header), sizeof(header)))
+            return false;
+
+        uint64_t header_size = sizeof(header);
+        record.meta = EntryMeta();
+        if (header.magic == codec_record_magic || header.magic == meta_record_magic)
+        {
+            CodecHeader codec_header;
+            if (!file_.read(reinterpret_cast<char *>(&codec_header), sizeof(codec_header)))
+                return false;
+            header_size += sizeof(codec_header);
+            record.codec = static_cast<Codec>(codec_header.codec);
+            record.raw_size = codec_header.raw_size;
+
+            if (header.magic == meta_record_magic)
+            {
+                if (!file_.read(reinterpret_cast<char *>(&record.meta), sizeof(record.meta)))
+                    return false;
+                header_size += sizeof(record.meta);
+            }
+        }
+        else if (header.magic == record_magic)
+        {
+            record.codec = Codec::none;
+            record.raw_size = header.data_size;
+        }
+        else
+            return false;
+
+        record.data_size = header.data_size;
+        record.size = header_size + header.key_size + header.data_size;
+        if (offset + record.size > pack_size_ || offset + record.size < offset)
+            return false;
+
+        record.key.resize(header.key_size);
+        return static_cast<bool>(file_.read(record.key.data(), record.key.size()));
+    }
+
+    static void copy_data(const std::string &stored, const Sink &sink)
+    {
+        for (size_t at = 0; at < stored.size(); at += chunk_bytes)
+            sink(stored.data() + at, std::min(stored.size() - at, chunk_bytes));
+    }
+
+    void inflate_data(const std::string &stored, const Sink &sink) const
+    {
+        z_stream stream{};
+        if (inflateInit(&stream) != Z_OK)
+            throw std::runtime_error("inflateInit failed");
+
+        std::vector<char> out(chunk_bytes);
+        size_t at = 0;
+        int status = Z_OK;
+        try
+        {
+            while (status != Z_STREAM_END)
+            {
+                if (stream.avail_in == 0)
+                {
+                    if (at == stored.size())
+                        break;
+                    size_t n = std::min(stored.size() - at, chunk_bytes);
+                    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(stored.data() + at));
+                    stream.avail_in = static_cast<uInt>(n);
+                    at += n;
+                }
+
+                stream.next_out = reinterpret_cast<Bytef *>(out.data());
+                stream.avail_out = static_cast<uInt>(out.size());
+                status = inflate(&stream, Z_NO_FLUSH);
+                if (status != Z_OK && status != Z_STREAM_END)
+                    break;
+
+                size_t produced = out.size() - stream.avail_out;
+                if (produced > 0)
+                    sink(out.data(), produced);
+            }
+        }
+        catch (...)
         {
-            throw std::runtime_error("Could not open cache file for writing");
+            inflateEnd(&stream);
+            throw;
         }
+        inflateEnd(&stream);
+
+        if (status != Z_STREAM_END)
+            throw std::runtime_error("Damaged compressed entry in cache file " + pack_path());
+    }
+
+    static std::string deflate_data(const std::string &data)
+    {
+        uLongf size = compressBound(static_cast<uLong>(data.size()));
+        std::string packed(size, '\0');
+        if (compress2(reinterpret_cast<Bytef *>(packed.data()), &size, reinterpret_cast<const Bytef *>(data.data()),
+                      static_cast<uLong>(data.size()), Z_BEST_SPEED) != Z_OK)
+            throw std::runtime_error("Could not compress cache entry");
+        packed.resize(size);
+        return packed;
+    }
+
+    // indexes the records from offset on, returns where the last complete one ends
+    uint64_t scan(uint64_t offset)
+    {
+        Record record;
+        while (offset < pack_size_ && read_record(offset, record))
+        {
+            if (record.codec == Codec::tombstone)
+            {
+                auto it = index_.find(hash(record.key));
+                if (it != index_.end())
+                {
+                    lru_.erase({it->second.last_access, it->first});
+                    remove(it->second);
+                    index_.erase(it);
+                }
+                dead_bytes_ += record.size;
+            }
+            else
+            {
+                // records found by a scan count as used when they were written
+                uint64_t written = record.meta.fetched_at > 0 ? static_cast<uint64_t>(record.meta.fetched_at) * 1000 : 1;
+                add(hash(record.key), Entry{offset, record.size, record.raw_size, written});
+            }
+            offset += record.size;
+        }
+        file_.clear();
+        return offset;
+    }
+
+    static uint64_t hash_check()
+    {
+        return hash("evdscpp cache index").h1;
+    }
+
+    // returns the pack length the loaded entries cover, 0 when there is no usable snapshot
+    uint64_t read_index()
+    {
+        std::ifstream in(index_path(), std::ios::binary);
+        if (!in)
+            return 0;
+
+        IndexHeader header;
+        if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != index_magic ||
+            header.entry_size != sizeof(evds::Hash128) + sizeof(Entry) || header.hash_check != hash_check())
+            return 0;
+
+        // a damaged count must not size the buffer, the pack is scanned instead
+        std::error_code ec;
+        uint64_t file_size = std::filesystem::file_size(index_path(), ec);
+        if (ec || header.count > (file_size - sizeof(header)) / header.entry_size ||
+            header.count * header.entry_size != file_size - sizeof(header))
+        {
+            std::cerr << "[cache] ignoring a damaged index " << index_path() << std::endl;
+            return 0;
+        }
+
+        std::vector<char> buffer(header.count * header.entry_size);
+        if (!in.read(buffer.data(), buffer.size()))
+            return 0;
+
+        index_.reserve(header.count);
+        for (uint64_t i = 0; i < header.count; ++i)
+        {
+            const char *p = buffer.data() + i * header.entry_size;
+            evds::Hash128 key_hash;
+            Entry entry;
+            std::memcpy(&key_hash, p, sizeof(key_hash));
+            std::memcpy(&entry, p + sizeof(key_hash), sizeof(entry));
+            index_[key_hash] = entry;
+        }
+        return header.covered;
+    }
+
+    void write_index()
+    {
+        IndexHeader header{index_magic, sizeof(evds::Hash128) + sizeof(Entry), hash_check(), pack_size_, index_.size()};
+
+        std::string buffer(reinterpret_cast<const char *>(&header), sizeof(header));
+        buffer.reserve(sizeof(header) + index_.size() * header.entry_size);
+        for (const auto &[key_hash, entry] : index_)
+        {
+            buffer.append(reinterpret_cast<const char *>(&key_hash), sizeof(key_hash));
+            buffer.append(reinterpret_cast<const char *>(&entry), sizeof(entry));
+        }
+
+        std::string tmp = index_path() + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            out.write(buffer.data(), buffer.size());
+            if (!out)
+                return;
+        }
+        std::filesystem::rename(tmp, index_path());
+    }
+
+    void compact_from(std::vector<std::pair<evds::Hash128, Entry>> entries, uint64_t end)
+    {
+        std::sort(entries.begin(), entries.end(), [](const auto &a, const auto &b)
+                  { return a.second.offset < b.second.offset; });
+
+        // key hash -> (offset in the old pack, entry in the new one)
+        std::unordered_map<evds::Hash128, std::pair<uint64_t, Entry>, evds::Hash128Hasher> copied;
+        std::string tmp = pack_path() + ".tmp";
+        std::ifstream in(pack_path(), std::ios::binary);
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        std::string record;
+        uint64_t offset = 0;
+        for (const auto &[key_hash, entry] : entries)
+        {
+            record.resize(entry.size);
+            in.clear();
+            in.seekg(static_cast<std::streamoff>(entry.offset));
+            if (!in.read(record.data(), record.size()))
+                continue;
 
-        file.write(data.c_str(), data.size());
-        file.close();
+            out.write(record.data(), record.size());
+            copied[key_hash] = {entry.offset, Entry{offset, entry.size, entry.raw_size, entry.last_access}};
+            offset += entry.size;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        compacting_ = false;
+
+        // records appended meanwhile go over as they are, tombstones included, so a scan still ends the same
+        uint64_t tail = offset;
+        in.clear();
+        in.seekg(static_cast<std::streamoff>(end));
+        std::vector<char> buffer(chunk_bytes);
+        for (uint64_t left = pack_size_ - end; left > 0;)
+        {
+            size_t n = std::min<uint64_t>(left, buffer.size());
+            if (!in.read(buffer.data(), n))
+                break;
+            out.write(buffer.data(), n);
+            offset += n;
+            left -= n;
+        }
+        out.close();
+        if (!out || offset - tail != pack_size_ - end)
+        {
+            std::filesystem::remove(tmp);
+            throw std::runtime_error("Could not compact cache file " + pack_path());
+        }
+
+        std::unordered_map<evds::Hash128, Entry, evds::Hash128Hasher> compacted;
+        for (const auto &[key_hash, entry] : index_)
+        {
+            if (entry.offset >= end)
+            {
+                compacted[key_hash] = Entry{entry.offset - end + tail, entry.size, entry.raw_size, entry.last_access};
+                continue;
+            }
+
+            auto it = copied.find(key_hash);
+            if (it != copied.end() && it->second.first == entry.offset)
+            {
+                compacted[key_hash] = it->second.second;
+                compacted[key_hash].last_access = entry.last_access;
+            }
+        }
+
+        // without a snapshot a crash before write_index() means a full scan, not stale offsets
+        in.close();
+        file_.close();
+        std::filesystem::remove(index_path());
+        std::filesystem::rename(tmp, pack_path());
+        open_file();
+
+        index_ = std::move(compacted);
+        pack_size_ = offset;
+        live_bytes_ = 0;
+        raw_bytes_ = 0;
+        for (const auto &[key_hash, entry] : index_)
+            count_live(entry, 1);
+        dead_bytes_ = pack_size_ - std::min(pack_size_, live_bytes_);
+        rebuild_lru();
+        write_index();
+        index_written_ = std::chrono::steady_clock::now();
+    }
+};
+
+// ...................................................... Cache
+/*
+Entries of one cache directory, keyed by function name and arguments.
+Constructing a Cache is cheap, every Cache of a directory shares its
+PackFile.
+*/
+class Cache
+{
+
+public:
+    Cache(const std::string &cache_dir, bool verbosein) : pack_(PackFile::open(cache_dir)), verbose(verbosein)
+    {
+    }
+
+    Cache() : pack_(PackFile::open(default_dir))
+    {
+    }
+
+    static Cache &instance()
+    {
+        static Cache cache;
+        return cache;
+    }
+
+    template <typename... Args>
+    bool check_and_load_cache(const std::string &function_name, std::string &result, const Args &...args)
+    {
+        if (!pack_->load(make_key(function_name, args...), result))
+            return false;
+
+        if (verbose)
+            std::cout << "[loading cache] " << pack_->pack_path() << "\n";
+        return true;
+    }
+
+    // like check_and_load_cache, the data goes to sink piece by piece
+    template <typename... Args>
+    bool check_and_stream_cache(const std::string &function_name, const PackFile::Sink &sink, const Args &...args)
+    {
+        if (!pack_->load_stream(make_key(function_name, args...), sink))
+            return false;
+
+        if (verbose)
+            std::cout << "[loading cache] " << pack_->pack_path() << "\n";
+        return true;
+    }
+
+    template <typename... Args>
+    std::optional<EntryMeta> load_cache_meta(const std::string &function_name, const Args &...args)
+    {
+        return pack_->meta(make_key(function_name, args...));
+    }
+
+    template <typename... Args>
+    bool erase_cache(const std::string &function_name, const Args &...args)
+    {
+        return pack_->erase(make_key(function_name, args...));
+    }
+
+    template <typename... Args>
+    void save_cache(const std::string &function_name, const std::string &data, const Args &...args)
+    {
+        pack_->save(make_key(function_name, args...), data);
+        if (verbose)
+            std::cout << "[saving cache] " << pack_->pack_path() << "\n";
+    }
+
+    // save_cache with metadata other than "fetched now"
+    template <typename... Args>
+    void save_cache_meta(const EntryMeta &meta, const std::string &function_name, const std::string &data, const Args &...args)
+    {
+        pack_->save(make_key(function_name, args...), data, meta);
+        if (verbose)
+            std::cout << "[saving cache] " << pack_->pack_path() << "\n";
+    }
+
+    PackFile &pack()
+    {
+        return *pack_;
+    }
+
+private:
+    static constexpr const char *default_dir = "./.caches";
+
+    std::shared_ptr<PackFile> pack_;
+    bool verbose = true;
+
+    template <typename... Args>
+    std::string make_key(const std::string &function_name, const Args &...args) const
+    {
+        std::stringstream ss;
+        ss << function_name;
+        (void)(ss << ... << args);
+        return ss.str();
     }
 };
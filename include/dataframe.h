@@ -39,6 +39,7 @@
 #include <cmath>
 #include <typeindex>
 #include <typeinfo> //   typeid
+#include <algorithm>
 #include "../extern/nlohmann/json.hpp"
 #include "series.h"
 #include "header.h"
@@ -114,6 +115,58 @@ namespace evds
             column[position] = value;
         }
 
+        // ............................................................. rows
+        size_t rows() const
+        {
+            size_t n = 0;
+            for (const auto &[_, column] : columns)
+                n = std::max(n, column.size());
+            return n;
+        }
+
+        // ............................................................. append
+        // rows of other go below the existing rows, missing cells become NaN
+        void append(const DataFrame &other)
+        {
+            size_t top = rows();
+            size_t total = top + other.rows();
+
+            for (const auto &[name, column] : other.columns)
+            {
+                if (columns.find(name) == columns.end())
+                {
+                    columns[name] = Column(top, std::monostate{});
+                    column_types[name] = other.column_types.count(name) ? other.column_types.at(name) : std::nullopt;
+                }
+
+                Column &target = columns[name];
+                target.resize(top, std::monostate{});
+                target.insert(target.end(), column.begin(), column.end());
+            }
+
+            for (auto &[_, column] : columns)
+                column.resize(total, std::monostate{});
+        }
+
+        // ............................................................. select_rows
+        // new frame with the given rows, in the given order
+        DataFrame select_rows(const std::vector<size_t> &positions) const
+        {
+            DataFrame result;
+            result.column_types = column_types;
+
+            for (const auto &[name, column] : columns)
+            {
+                Column selected;
+                selected.reserve(positions.size());
+                for (size_t pos : positions)
+                    selected.push_back(pos < column.size() ? column[pos] : Cell(std::monostate{}));
+
+                result.columns[name] = std::move(selected);
+            }
+            return result;
+        }
+
         std::type_index get_column_type(const std::string &column_name) const
         {
             auto it = column_types.find(column_name);
@@ -264,11 +317,15 @@ void save_as_csv(const DataFrame &df, const std::string &filename, std::optional
 
     char actual_delimiter = delimiter.value_or(';');
 
+    // the date first, then by name: the same file whichever way the frame was built
+    // (DOM or stream parser, cached frame)
     auto column_names = df.get_column_names();
+    std::sort(column_names.begin(), column_names.end(), [](const std::string &a, const std::string &b)
+              { return std::make_pair(a != "Tarih", a) < std::make_pair(b != "Tarih", b); });
     size_t max_num_rows = 0;
 
     for (const auto &col_name : column_names) {
-        auto col_data = df.columns.at(col_name);
+        const auto &col_data = df.columns.at(col_name);
         max_num_rows = std::max(max_num_rows, col_data.size());
     }
 
@@ -0,0 +1,409 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Sermet Pekin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "dataframe.h"
+
+namespace evds
+{
+
+    using Days = std::chrono::sys_days;
+
+    // .................................................................. parse_date
+    // "dd-mm-yyyy" as used by Config::start_date / end_date
+    std::optional<Days> parse_date(const std::string &str)
+    {
+        int d = 0, m = 0, y = 0;
+        char tail = 0;
+        if (std::sscanf(str.c_str(), "%d-%d-%d%c", &d, &m, &y, &tail) != 3)
+            return std::nullopt;
+
+        std::chrono::year_month_day ymd{std::chrono::year(y), std::chrono::month(m), std::chrono::day(d)};
+        if (!ymd.ok())
+            return std::nullopt;
+
+        return Days(ymd);
+    }
+
+    std::string format_date(Days days)
+    {
+        std::chrono::year_month_day ymd(days);
+
+        char buffer[16];
+        std::snprintf(buffer, sizeof(buffer), "%02u-%02u-%04d",
+                      static_cast<unsigned>(ymd.day()), static_cast<unsigned>(ymd.month()), static_cast<int>(ymd.year()));
+        return buffer;
+    }
+
+    Days today()
+    {
+        return std::chrono::floor<std::chrono::days>(std::chrono::system_clock::now());
+    }
+
+    // .................................................................. DateRange
+    struct DateRange
+    {
+        Days start;
+        Days end; // inclusive
+
+        int days() const
+        {
+            return static_cast<int>((end - start).count()) + 1;
+        }
+    };
+
+    // .................................................................. chunk_days
+    /*
+    Initial chunk length for a frequency, roughly a thousand observations
+    per request. Low frequencies are never worth splitting.
+    */
+    int chunk_days(const std::string &frequency)
+    {
+        static const std::unordered_map<std::string, int> daysDict = {
+            {"daily", 730},
+            {"business", 1095},
+            {"weekly", 3650},
+            {"semimonthly", 7300},
+            {"monthly", 14600},
+        };
+
+        auto it = daysDict.find(frequency);
+        if (it != daysDict.end())
+            return it->second;
+
+        if (frequency == "default")
+            return 1825; // native frequency unknown, most of them are daily
+
+        return 36500;
+    }
+
+    // .................................................................. day_separable
+    /*
+    True when every row may depend on its own day only, so a window may be
+    cut at any day and the pieces stitched or sliced back: daily or
+    business frequency and level values. Weekly and longer frequencies
+    aggregate across a cut, percent changes, differences and moving windows
+    look back over it. The default (native) frequency passes here, the
+    first rows then decide (daily_rows).
+    */
+    bool day_separable(const std::string &frequency, const std::string &formulas)
+    {
+        if (frequency != "default" && frequency != "daily" && frequency != "business")
+            return false;
+
+        return formulas == "default" || formulas == "level";
+    }
+
+    // .................................................................. daily_rows
+    /*
+    True when the rows of df are dd-mm-yyyy dates of a daily or business
+    series: at least two of them, mostly a day or a weekend apart. Decides
+    whether a window at the default frequency may be split.
+    */
+    bool daily_rows(const DataFrame &df, const std::string &date_col = "Tarih")
+    {
+        auto it = df.columns.find(date_col);
+        if (it == df.columns.end() || it->second.size() < 2)
+            return false;
+
+        std::vector<Days> dates;
+        for (const auto &cell : it->second)
+        {
+            const auto *str = std::get_if<std::string>(&cell);
+            auto date = str ? parse_date(*str) : std::nullopt;
+            if (!date)
+                return false;
+            dates.push_back(*date);
+        }
+        std::sort(dates.begin(), dates.end());
+
+        std::vector<int> steps;
+        for (size_t i = 1; i < dates.size(); ++i)
+            steps.push_back(static_cast<int>((dates[i] - dates[i - 1]).count()));
+        std::nth_element(steps.begin(), steps.begin() + steps.size() / 2, steps.end());
+        return steps[steps.size() / 2] <= 3;
+    }
+
+    // .................................................................. RangePlanner
+    /*
+    Hands out consecutive chunks of a date range.
+
+    The chunk length starts at chunk_days(frequency) and adapts to the
+    latency each finished chunk actually saw: it is scaled towards
+    target_ms, by at most 2x per observation and within [initial/8, initial*8].
+    */
+    class RangePlanner
+    {
+    public:
+        RangePlanner(DateRange whole, Days final_end, int initial_days, double target_ms)
+            : whole_(whole), final_end_(final_end), cursor_(whole.start), span_(std::max(initial_days, 1)),
+              min_span_(std::max(initial_days / 8, 1)), max_span_(initial_days * 8), target_ms_(target_ms)
+        {
+        }
+
+        bool done() const
+        {
+            return cursor_ > whole_.end;
+        }
+
+        DateRange next()
+        {
+            DateRange range{cursor_, std::min(whole_.end, cursor_ + std::chrono::days(span_ - 1))};
+            cursor_ = range.end + std::chrono::days(1);
+
+            if (range.end == whole_.end)
+                range.end = std::max(range.end, final_end_);
+            return range;
+        }
+
+        void observe(const DateRange &range, double latency_ms)
+        {
+            latency_ms = std::max(latency_ms, 1.0);
+
+            int days = std::min(range.days(), span_ * 2);
+
+            double factor = std::clamp(target_ms_ / latency_ms, 0.5, 2.0);
+            double wanted = days * factor;
+
+            span_ = std::clamp(static_cast<int>(wanted), min_span_, max_span_);
+        }
+
+        int span_days() const
+        {
+            return span_;
+        }
+
+    private:
+        DateRange whole_;
+        Days final_end_;
+        Days cursor_;
+        int span_;
+        int min_span_;
+        int max_span_;
+        double target_ms_;
+    };
+
+    // .................................................................. plan_range
+    /*
+    Range to split for this config, or nullopt when one request is enough
+    or the rows are not day_separable. Open ended windows (end_date defaults to 2100) are planned up to today,
+    the last chunk still runs to the configured end_date (final_end).
+    */
+    struct RangePlan
+    {
+        DateRange planned;
+        Days final_end;
+    };
+
+    std::optional<RangePlan> plan_range(const std::string &start_date, const std::string &end_date, const std::string &frequency,
+                                        const std::string &formulas)
+    {
+        if (!day_separable(frequency, formulas))
+            return std::nullopt;
+
+        auto start = parse_date(start_date);
+        auto end = parse_date(end_date);
+        if (!start || !end || *end < *start)
+            return std::nullopt;
+
+        DateRange planned{*start, std::min(*end, std::max(*start, today()))};
+
+        if (planned.days() <= chunk_days(frequency))
+            return std::nullopt;
+
+        return RangePlan{planned, *end};
+    }
+
+    // .................................................................. date_sort_key
+    // "dd-mm-yyyy" sorts as "yyyy-mm-dd", other period labels (2020, 2020-Q1) as they are
+    std::string date_sort_key(const Cell &cell)
+    {
+        return std::visit([](const auto &value) -> std::string
+                          {
+            using T = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<T, std::monostate>)
+            {
+                return "";
+            }
+            else if constexpr (std::is_same_v<T, std::string>)
+            {
+                if (value.size() == 10 && value[2] == '-' && value[5] == '-')
+                    return value.substr(6, 4) + "-" + value.substr(3, 2) + "-" + value.substr(0, 2);
+                return value;
+            }
+            else
+            {
+                return std::to_string(value);
+            } }, cell);
+    }
+
+    // .................................................................. last_observation
+    // latest dd-mm-yyyy date in date_col, nullopt if some row has another format
+    std::optional<Days> last_observation(const DataFrame &df, const std::string &date_col = "Tarih")
+    {
+        auto it = df.columns.find(date_col);
+        if (it == df.columns.end() || it->second.empty())
+            return std::nullopt;
+
+        std::optional<Days> last;
+        for (const auto &cell : it->second)
+        {
+            const auto *str = std::get_if<std::string>(&cell);
+            auto date = str ? parse_date(*str) : std::nullopt;
+            if (!date)
+                return std::nullopt;
+
+            last = last ? std::max(*last, *date) : *date;
+        }
+        return last;
+    }
+
+    // .................................................................. rows_between
+    // rows whose date_col lies in [start, end], rows without a date are kept
+    DataFrame rows_between(const DataFrame &df, Days start, Days end, const std::string &date_col = "Tarih")
+    {
+        auto it = df.columns.find(date_col);
+        if (it == df.columns.end())
+            return df;
+
+        std::vector<size_t> keep;
+        const Column &dates = it->second;
+        for (size_t pos = 0; pos < dates.size(); ++pos)
+        {
+            const auto *str = std::get_if<std::string>(&dates[pos]);
+            auto date = str ? parse_date(*str) : std::nullopt;
+            if (!date || (*date >= start && *date <= end))
+                keep.push_back(pos);
+        }
+
+        return df.select_rows(keep);
+    }
+
+    // .................................................................. stitch_frames
+    /*
+    Concatenates chunk results, sorts the rows by date_col and keeps the
+    first row for dates that came back from two overlapping chunks.
+    */
+    DataFrame stitch_frames(const std::vector<DataFrame> &parts, const std::string &date_col = "Tarih")
+    {
+        DataFrame all;
+        for (const auto &part : parts)
+            all.append(part);
+
+        auto it = all.columns.find(date_col);
+        if (it == all.columns.end())
+            return all;
+
+        const Column &dates = it->second;
+
+        std::vector<std::string> keys;
+        keys.reserve(dates.size());
+        for (const auto &cell : dates)
+            keys.push_back(date_sort_key(cell));
+
+        std::vector<size_t> order(dates.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+
+        std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b)
+                         { return keys[a] < keys[b]; });
+
+        std::vector<size_t> unique_rows;
+        std::unordered_set<std::string> seen;
+        for (size_t pos : order)
+        {
+            if (keys[pos].empty() || seen.insert(keys[pos]).second)
+                unique_rows.push_back(pos);
+        }
+
+        return all.select_rows(unique_rows);
+    }
+
+    // .................................................................. join_frames
+    /*
+    Puts the columns of frames of different series side by side, one row
+    per date_col value, sorted by date. A column found in several parts
+    (the date, YEARWEEK ...) is taken from the first part that has it.
+    */
+    DataFrame join_frames(const std::vector<DataFrame> &parts, const std::string &date_col = "Tarih")
+    {
+        std::map<std::string, Cell> dates; // sort key -> date
+        for (const auto &part : parts)
+        {
+            auto it = part.columns.find(date_col);
+            if (it == part.columns.end())
+                continue;
+            for (const auto &cell : it->second)
+                dates.emplace(date_sort_key(cell), cell);
+        }
+
+        DataFrame joined;
+        std::unordered_map<std::string, size_t> row_of;
+        Column &date_column = joined.columns[date_col];
+        for (const auto &[key, cell] : dates)
+        {
+            row_of[key] = date_column.size();
+            date_column.push_back(cell);
+        }
+
+        for (const auto &part : parts)
+        {
+            auto it = part.columns.find(date_col);
+            if (it == part.columns.end())
+                continue;
+
+            if (!joined.column_types.count(date_col) && part.column_types.count(date_col))
+                joined.column_types[date_col] = part.column_types.at(date_col);
+
+            for (const auto &[name, column] : part.columns)
+            {
+                if (joined.columns.count(name))
+                    continue;
+
+                Column target(dates.size(), std::monostate{});
+                for (size_t pos = 0; pos < column.size() && pos < it->second.size(); ++pos)
+                    target[row_of[date_sort_key(it->second[pos])]] = column[pos];
+
+                joined.columns[name] = std::move(target);
+                joined.column_types[name] = part.column_types.count(name) ? part.column_types.at(name) : std::nullopt;
+            }
+        }
+        return joined;
+    }
+
+}
@@ -31,6 +31,9 @@
 #define dotenv__
 #include "../extern/dotenv/dotenv.h"
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
 
 using namespace std;
 
@@ -43,5 +46,31 @@ std::string get_api_key(  )
     return apikey;
 }
 
+// "k1, k2,k3" -> {"k1", "k2", "k3"}
+std::vector<std::string> split_api_keys(const std::string &str)
+{
+    std::vector<std::string> keys;
+    std::stringstream ss(str);
+    std::string key;
+    while (std::getline(ss, key, ','))
+    {
+        auto first = key.find_first_not_of(" \t");
+        auto last = key.find_last_not_of(" \t");
+        if (first != std::string::npos)
+            keys.push_back(key.substr(first, last - first + 1));
+    }
+    return keys;
+}
+
+// EVDS_APIKEYS from .env, or the single EVDS_APIKEY
+std::vector<std::string> get_api_keys()
+{
+    dotenv env(".env");
+    auto keys = split_api_keys(env.get("EVDS_APIKEYS", ""));
+    if (keys.empty())
+        keys.push_back(get_api_key());
+    return keys;
+}
+
 
 #endif // dotenv__
@@ -3,6 +3,9 @@
 #include <unordered_map>
 #include <utility>
 #include <functional>
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
 #include <fstream>
 
 #include <type_traits>
@@ -92,11 +95,35 @@ std::vector<std::string> indexes_from_file(const std::string &file_path)
 }
 
 
-void setConfigOptions(const std::unordered_map<std::string, std::string> &args, Config &config)
+// numeric option values: the whole string, no negative numbers
+// (std::stoul("-1") wraps around)
+size_t parse_count(const std::string &val)
+{
+    if (val.empty() || !std::all_of(val.begin(), val.end(), [](unsigned char c)
+                                    { return std::isdigit(c); }))
+        throw std::invalid_argument("not a non-negative integer: " + val);
+    return std::stoul(val);
+}
+
+double parse_non_negative(const std::string &val)
+{
+    size_t end = 0;
+    double value = std::stod(val, &end);
+    if (end != val.size() || !(value >= 0))
+        throw std::invalid_argument("not a non-negative number: " + val);
+    return value;
+}
+
+// false (after reporting it) when an option has an invalid value
+bool setConfigOptions(const std::unordered_map<std::string, std::string> &args, Config &config)
 {
     std::unordered_map<std::string, std::function<void(const std::string &)>> configSetters = {
         {"cache", [&](const std::string &val)
          { config.cache = (val == "true"); }},
+        {"stale_while_revalidate", [&](const std::string &val)
+         { config.stale_while_revalidate = (val == "true"); }},
+        {"cache_max_mb", [&](const std::string &val)
+         { config.cache_max_mb = parse_non_negative(val); }},
         {"test", [&](const std::string &val)
          { config.test = (val == "true"); }},
 
@@ -119,15 +146,74 @@ void setConfigOptions(const std::unordered_map<std::string, std::string> &args,
         {"formulas", [&](const std::string &val)
          { config.formulas = val; }},
         {"aggregation", [&](const std::string &val)
-         { config.aggregation = val; }}};
+         { config.aggregation = val; }},
+        {"pool_size", [&](const std::string &val)
+         { config.pool_size = parse_count(val); }},
+        {"jobs", [&](const std::string &val)
+         { config.jobs = parse_count(val); }},
+        {"stream", [&](const std::string &val)
+         { config.stream = (val == "true"); }},
+        {"split", [&](const std::string &val)
+         { config.split = (val == "true"); }},
+        {"chunk_target_ms", [&](const std::string &val)
+         { config.chunk_target_ms = parse_non_negative(val); }},
+        {"batch", [&](const std::string &val)
+         { config.batch = (val == "true"); }},
+        {"max_url_length", [&](const std::string &val)
+         { config.max_url_length = parse_count(val); }},
+        {"max_jobs", [&](const std::string &val)
+         { config.max_jobs = parse_count(val); }},
+        {"rate_limit", [&](const std::string &val)
+         { config.rate_limit = parse_non_negative(val); }},
+        {"burst", [&](const std::string &val)
+         { config.burst = parse_non_negative(val); }},
+        {"healthy_latency_ms", [&](const std::string &val)
+         { config.healthy_latency_ms = parse_non_negative(val); }},
+        {"retries", [&](const std::string &val)
+         { config.retries = static_cast<int>(parse_count(val)); }},
+        {"retry_base_ms", [&](const std::string &val)
+         { config.retry_base_ms = parse_non_negative(val); }},
+        {"retry_max_ms", [&](const std::string &val)
+         { config.retry_max_ms = parse_non_negative(val); }},
+        {"timeout_ms", [&](const std::string &val)
+         { config.timeout_ms = static_cast<long>(parse_count(val)); }},
+        {"connect_timeout_ms", [&](const std::string &val)
+         { config.connect_timeout_ms = static_cast<long>(parse_count(val)); }},
+        {"hedge", [&](const std::string &val)
+         { config.hedge = (val == "true"); }},
+        {"priority", [&](const std::string &val)
+         { config.priority = val; }},
+        {"transport", [&](const std::string &val)
+         { config.transport = val; }},
+        {"fixture_dir", [&](const std::string &val)
+         { config.fixture_dir = val; }},
+        {"replay_latency_ms", [&](const std::string &val)
+         { config.replay_latency_ms = parse_non_negative(val); }},
+        {"incremental", [&](const std::string &val)
+         { config.incremental = (val == "true"); }},
+        {"warm_up", [&](const std::string &val)
+         { config.warm_up = (val == "true"); }},
+        {"budget_ms", [&](const std::string &val)
+         { config.budget_ms = parse_non_negative(val); }},
+        {"deadline_ms", [&](const std::string &val)
+         { config.deadline_ms = parse_non_negative(val); }}};
 
     for (const auto &arg : args)
     {
         if (configSetters.count(arg.first))
         {
-            configSetters[arg.first](arg.second);
+            try
+            {
+                configSetters[arg.first](arg.second);
+            }
+            catch (const std::exception &)
+            {
+                std::cerr << "Invalid value for --" << arg.first << ": " << arg.second << std::endl;
+                return false;
+            }
         }
     }
+    return true;
 }
 
 
@@ -151,12 +237,55 @@ void show_usage()
     std::cout << "                            Example: --end_date 31-12-2021\n";
     std::cout << "  --cache <true|false>      Enable or disable caching.\n";
     std::cout << "                            Example: --cache true\n";
+    std::cout << "  --stale_while_revalidate <true|false> Serve expired cache entries at once and refresh them in the\n";
+    std::cout << "                            background (default true), false refetches them first.\n";
+    std::cout << "  --cache_max_mb <mb>       Size limit of the cache, least recently used entries are evicted (default 0, none).\n";
+    std::cout << "                            Example: --cache_max_mb 500\n";
     std::cout << "  --frequency <frequency>   Set the frequency (e.g., daily, monthly, annual).\n";
     std::cout << "                            Example: --frequency monthly\n";
     std::cout << "  --formulas <formulas>     Set the formulas (e.g., avg, sum).\n";
     std::cout << "                            Example: --formulas avg\n";
     std::cout << "  --aggregation <type>      Set the aggregation type.\n";
-    std::cout << "                            Example: --aggregation avg\n\n";
+    std::cout << "                            Example: --aggregation avg\n";
+    std::cout << "  --pool_size <n>           Number of idle curl handles kept for reuse.\n";
+    std::cout << "                            Example: --pool_size 8\n";
+    std::cout << "  --jobs <n>                Number of index groups requested concurrently.\n";
+    std::cout << "                            Example: --jobs 16\n";
+    std::cout << "  --stream <true|false>     Parse the response while it downloads (default true).\n";
+    std::cout << "                            Example: --stream false\n";
+    std::cout << "  --split <true|false>      Fetch long date windows as concurrent chunks (default true).\n";
+    std::cout << "                            Example: --split false\n";
+    std::cout << "  --chunk_target_ms <ms>    Latency the chunk size adapts towards (default 2000).\n";
+    std::cout << "                            Example: --chunk_target_ms 1000\n";
+    std::cout << "  --batch <true|false>      Merge index groups into multi-series requests (default true).\n";
+    std::cout << "                            Example: --batch false\n";
+    std::cout << "  --max_url_length <n>      Longest URL a merged request may have (default 2000).\n";
+    std::cout << "                            Example: --max_url_length 1500\n";
+    std::cout << "  --rate_limit <n>          Requests per second, 0 for no limit (default 20).\n";
+    std::cout << "                            Example: --rate_limit 5\n";
+    std::cout << "  --burst <n>               Requests that may start at once (default 10).\n";
+    std::cout << "  --max_jobs <n>            Let concurrency grow from --jobs up to this while the server is healthy\n";
+    std::cout << "                            (default: stay at --jobs).\n";
+    std::cout << "  --healthy_latency_ms <ms> Slower responses do not raise concurrency (default 5000).\n";
+    std::cout << "  --retries <n>             Extra attempts after timeouts, network errors, 429 or 5xx (default 3).\n";
+    std::cout << "  --retry_base_ms <ms>      First retry delay, doubled for each retry with random jitter (default 250).\n";
+    std::cout << "  --retry_max_ms <ms>       Upper bound for the retry delay (default 8000).\n";
+    std::cout << "  --timeout_ms <ms>         Time limit for one attempt, 0 for none (default 120000).\n";
+    std::cout << "  --connect_timeout_ms <ms> Time limit for connecting (default 10000).\n";
+    std::cout << "  --hedge <true|false>      Send a duplicate of requests slower than the p95 latency (default false).\n";
+    std::cout << "                            Example: --hedge true\n";
+    std::cout << "  --priority <class>        interactive, normal or bulk, queued requests of higher classes start first (default normal).\n";
+    std::cout << "                            Example: --priority bulk\n";
+    std::cout << "  --transport <name>        curl, record (curl and save responses) or replay (saved responses, no network).\n";
+    std::cout << "                            Example: --transport replay --cache false\n";
+    std::cout << "  --fixture_dir <dir>       Where record saves and replay reads responses (default fixtures).\n";
+    std::cout << "  --replay_latency_ms <ms>  Simulated latency of a replayed response (default 0).\n";
+    std::cout << "  --incremental <true|false> With --cache, request only observations after the last stored date (default false).\n";
+    std::cout << "                            Example: --incremental true\n";
+    std::cout << "  --warm_up <true|false>    Open the connection to EVDS at startup (default true).\n";
+    std::cout << "  --budget_ms <ms>          Time budget for the whole run, unfinished requests are cancelled (default 0, none).\n";
+    std::cout << "  --deadline_ms <ms>        Time limit for one request including its retries (default 0, none).\n";
+    std::cout << "                            Example: --budget_ms 600000 --deadline_ms 60000\n\n";
 
     std::cout << "Examples:\n";
     std::cout << "  # 1. Each index will have its own file:\n";
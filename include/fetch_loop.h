@@ -0,0 +1,631 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Sermet Pekin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <curl/curl.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "pool.h"
+#include "key_pool.h"
+
+namespace evds
+{
+
+    // .................................................................. Priority
+    // interactive lookups, ordinary requests, backfills
+    enum class Priority
+    {
+        interactive,
+        normal,
+        bulk
+    };
+
+    constexpr size_t priority_count = 3;
+
+    Priority priority_class(const std::string &name)
+    {
+        if (name == "interactive")
+            return Priority::interactive;
+        if (name == "normal")
+            return Priority::normal;
+        if (name == "bulk")
+            return Priority::bulk;
+
+        throw std::runtime_error("Unknown priority: " + name + " (interactive | normal | bulk)");
+    }
+
+    const char *priority_name(Priority priority)
+    {
+        static const char *names[] = {"interactive", "normal", "bulk"};
+        return names[static_cast<size_t>(priority)];
+    }
+
+    // .................................................................. QueueStats
+    // time due jobs spent in the FetchLoop queue before their transfer started
+    struct QueueStats
+    {
+        std::array<size_t, priority_count> started{};
+        std::array<double, priority_count> total_wait_ms{};
+        std::array<double, priority_count> max_wait_ms{};
+
+        void record(Priority priority, double wait_ms)
+        {
+            size_t i = static_cast<size_t>(priority);
+            ++started[i];
+            total_wait_ms[i] += wait_ms;
+            max_wait_ms[i] = std::max(max_wait_ms[i], wait_ms);
+        }
+
+        std::string str() const
+        {
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(1) << "[queue]";
+            for (size_t i = 0; i < priority_count; ++i)
+            {
+                if (started[i] == 0)
+                    continue;
+                oss << " " << priority_name(static_cast<Priority>(i)) << ": " << started[i]
+                    << " avg wait: " << total_wait_ms[i] / started[i] << " ms"
+                    << " max: " << max_wait_ms[i] << " ms";
+            }
+            if (started == std::array<size_t, priority_count>{})
+                oss << " no transfers";
+            return oss.str();
+        }
+    };
+
+    // .................................................................. FetchJob
+    /*
+    One transfer for the FetchLoop.
+
+    setup    : called on the loop thread with a clean easy handle and the
+               API key the KeyPool picked for it, sets URL, headers, write
+               callback ...
+    done     : called on the loop thread once the transfer finished, with
+               CURLE_ABORTED_BY_CALLBACK (and possibly no handle) when the
+               job was cancelled
+    priority : queue the job waits in until a slot and a token are free
+    */
+    struct FetchJob
+    {
+        std::function<void(CURL *, const std::string &api_key)> setup;
+        std::function<void(CURL *, CURLcode)> done;
+        // called instead of done when setup throws; without it done gets CURLE_FAILED_INIT
+        std::function<void(std::exception_ptr)> failed;
+        Priority priority = Priority::normal;
+    };
+
+    // .................................................................. FetchLoop
+    /*
+    curl_multi event loop running on its own thread.
+
+    Jobs are queued with submit(), optionally not before a delay (retry
+    backoff, hedged requests) and with a deadline after which a job that
+    has not started yet ends with CURLE_OPERATION_TIMEDOUT. At most max_in_flight of them are
+    transferring at the same time. Each start also needs a key with a free
+    slot and a token from the KeyPool, which is told how every transfer
+    ended. All transfers
+    share the multi handle's connection cache, so keep-alive connections
+    are reused across jobs.
+
+    Every priority class has its own FIFO queue. Free slots go to the due
+    class with the smallest virtual time, which advances by 1/weight per
+    start (weights 16, 4, 1): interactive jobs pass queued bulk work, and
+    bulk still gets a share while interactive traffic keeps coming.
+    queue_stats() tells how long the due jobs of each class waited.
+
+    Finished easy handles go back to an idle cache of at most idle_capacity
+    handles (config.pool_size), extra ones are cleaned up.
+
+    cancel() drops a queued job or aborts a running one, its done is still
+    called once. schedule() runs a plain function on the loop thread after a
+    delay, without a transfer, slot or token (simulated requests).
+    */
+    class FetchLoop
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using JobId = uint64_t;
+
+        static FetchLoop &instance()
+        {
+            static FetchLoop loop;
+            return loop;
+        }
+
+        FetchLoop(const FetchLoop &) = delete;
+        FetchLoop &operator=(const FetchLoop &) = delete;
+
+        ~FetchLoop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            curl_multi_wakeup(multi_);
+            if (thread_.joinable())
+                thread_.join();
+
+            for (auto &[handle, active] : active_)
+            {
+                curl_multi_remove_handle(multi_, handle);
+                curl_easy_cleanup(handle);
+            }
+            for (auto *handle : idle_)
+                curl_easy_cleanup(handle);
+
+            curl_multi_cleanup(multi_);
+        }
+
+        void set_max_in_flight(size_t n)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                max_in_flight_ = n > 0 ? n : 1;
+            }
+            curl_multi_setopt(multi_, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(max_in_flight_));
+            curl_multi_wakeup(multi_);
+        }
+
+        // idle easy handles kept for reuse, trimmed by the loop thread
+        void set_idle_capacity(size_t n)
+        {
+            idle_capacity_ = n > 0 ? n : 1;
+            curl_multi_wakeup(multi_);
+        }
+
+        JobId submit(FetchJob job, std::chrono::milliseconds delay = std::chrono::milliseconds(0),
+                     Clock::time_point deadline = Clock::time_point::max())
+        {
+            JobId id = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                id = ++last_id_;
+                auto &queue = pending_[static_cast<size_t>(job.priority)];
+                queue.push_back(Pending{id, Clock::now() + delay, deadline, std::move(job)});
+            }
+            curl_multi_wakeup(multi_);
+            return id;
+        }
+
+        JobId schedule(std::function<void()> fn, std::chrono::milliseconds delay)
+        {
+            FetchJob job; // no setup : a timer
+            job.done = [fn = std::move(fn)](CURL *, CURLcode code)
+            {
+                if (code != CURLE_ABORTED_BY_CALLBACK)
+                    fn();
+            };
+            return submit(std::move(job), delay);
+        }
+
+        void cancel(JobId id)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                cancelled_.push_back(id);
+            }
+            curl_multi_wakeup(multi_);
+        }
+
+        QueueStats queue_stats()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return queue_stats_;
+        }
+
+    private:
+        struct Pending
+        {
+            JobId id;
+            Clock::time_point not_before;
+            Clock::time_point deadline;
+            FetchJob job;
+            Clock::time_point queued = Clock::now();
+        };
+
+        struct Active
+        {
+            JobId id;
+            size_t key_slot;
+            FetchJob job;
+        };
+
+        FetchLoop()
+        {
+            CurlGlobal::ensure();
+            CurlShare::instance();
+            multi_ = curl_multi_init();
+            if (!multi_)
+                throw std::runtime_error("curl_multi_init() failed.");
+
+            thread_ = std::thread([this]
+                                  { run(); });
+        }
+
+        CURLM *multi_ = nullptr;
+        std::thread thread_;
+
+        static constexpr std::array<double, priority_count> weights = {16, 4, 1};
+
+        std::mutex mutex_;
+        std::array<std::deque<Pending>, priority_count> pending_;
+        std::array<double, priority_count> virtual_time_{};
+        double current_virtual_time_ = 0;
+        QueueStats queue_stats_;
+        std::vector<JobId> cancelled_;
+        size_t max_in_flight_ = 4;
+        std::atomic<size_t> idle_capacity_{4};
+        JobId last_id_ = 0;
+        bool stop_ = false;
+
+        // only touched by the loop thread
+        std::unordered_map<CURL *, Active> active_;
+        std::vector<CURL *> idle_;
+
+        void park(CURL *handle)
+        {
+            if (idle_.size() < idle_capacity_)
+                idle_.push_back(handle);
+            else
+                curl_easy_cleanup(handle);
+        }
+
+        void start_pending()
+        {
+            auto &keys = KeyPool::instance();
+            auto now = Clock::now();
+
+            std::deque<std::pair<Pending, size_t>> ready;
+            std::vector<FetchJob> timers;
+            std::vector<FetchJob> expired;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+
+                // first due transfer of each class, expired jobs and timers leave right away
+                std::array<std::deque<Pending>::iterator, priority_count> heads;
+                for (size_t c = 0; c < priority_count; ++c)
+                {
+                    auto &queue = pending_[c];
+                    for (auto it = queue.begin(); it != queue.end();)
+                    {
+                        if (it->deadline <= now)
+                        {
+                            expired.push_back(std::move(it->job));
+                            it = queue.erase(it);
+                        }
+                        else if (it->not_before <= now && !it->job.setup)
+                        {
+                            timers.push_back(std::move(it->job));
+                            it = queue.erase(it);
+                        }
+                        else
+                            ++it;
+                    }
+                    heads[c] = next_due(queue, queue.begin(), now);
+                }
+
+                while (active_.size() + ready.size() < max_in_flight_)
+                {
+                    std::optional<size_t> pick;
+                    for (size_t c = 0; c < priority_count; ++c)
+                    {
+                        if (heads[c] == pending_[c].end())
+                            continue;
+                        // a class that was idle starts at the current virtual time, without credit
+                        virtual_time_[c] = std::max(virtual_time_[c], current_virtual_time_);
+                        if (!pick || virtual_time_[c] + 1.0 / weights[c] < virtual_time_[*pick] + 1.0 / weights[*pick])
+                            pick = c;
+                    }
+                    if (!pick)
+                        break;
+
+                    auto slot = keys.try_acquire();
+                    if (!slot)
+                        break;
+
+                    size_t c = *pick;
+                    auto &queue = pending_[c];
+                    auto it = heads[c];
+
+                    current_virtual_time_ = virtual_time_[c];
+                    virtual_time_[c] += 1.0 / weights[c];
+
+                    auto due_since = std::max(it->queued, it->not_before);
+                    queue_stats_.record(static_cast<Priority>(c), std::chrono::duration<double, std::milli>(now - due_since).count());
+
+                    ready.emplace_back(std::move(*it), *slot);
+                    it = queue.erase(it);
+                    heads[c] = next_due(queue, it, now);
+                }
+            }
+
+            for (auto &job : expired)
+                finish(job, nullptr, CURLE_OPERATION_TIMEDOUT);
+            for (auto &timer : timers)
+                finish(timer, nullptr, CURLE_OK);
+
+            for (auto &[entry, slot] : ready)
+            {
+                CURL *handle = nullptr;
+                if (!idle_.empty())
+                {
+                    handle = idle_.back();
+                    idle_.pop_back();
+                    curl_easy_reset(handle);
+                }
+                else
+                {
+                    handle = curl_easy_init();
+                }
+
+                if (!handle)
+                {
+                    keys.release(slot, Outcome::failed, 0);
+                    finish(entry.job, nullptr, CURLE_FAILED_INIT);
+                    continue;
+                }
+
+                CurlShare::instance().attach(handle);
+                curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+                // wait for a connection being set up if it may multiplex (HTTP/2)
+                curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+                try
+                {
+                    entry.job.setup(handle, keys.key(slot));
+                }
+                catch (...)
+                {
+                    keys.release(slot, Outcome::failed, 0);
+                    park(handle);
+                    fail(entry.job, std::current_exception());
+                    continue;
+                }
+                curl_multi_add_handle(multi_, handle);
+                active_.emplace(handle, Active{entry.id, slot, std::move(entry.job)});
+            }
+        }
+
+        static std::deque<Pending>::iterator next_due(std::deque<Pending> &queue, std::deque<Pending>::iterator from,
+                                                      Clock::time_point now)
+        {
+            return std::find_if(from, queue.end(), [now](const Pending &entry)
+                                { return entry.not_before <= now; });
+        }
+
+        size_t collect_done()
+        {
+            size_t finished = 0;
+            int queued = 0;
+            while (CURLMsg *msg = curl_multi_info_read(multi_, &queued))
+            {
+                if (msg->msg != CURLMSG_DONE)
+                    continue;
+
+                CURL *handle = msg->easy_handle;
+                CURLcode code = msg->data.result;
+
+                curl_multi_remove_handle(multi_, handle);
+
+                auto it = active_.find(handle);
+                if (it != active_.end())
+                {
+                    report(handle, code, it->second.key_slot);
+                    FetchJob job = std::move(it->second.job);
+                    active_.erase(it);
+                    finish(job, handle, code);
+                }
+                park(handle);
+                ++finished;
+            }
+            return finished;
+        }
+
+        // queued jobs are dropped, running ones removed from the multi handle
+        void cancel_requested()
+        {
+            std::vector<JobId> ids;
+            std::vector<FetchJob> dropped;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ids.swap(cancelled_);
+
+                for (auto &queue : pending_)
+                {
+                    for (auto it = queue.begin(); it != queue.end();)
+                    {
+                        if (std::find(ids.begin(), ids.end(), it->id) != ids.end())
+                        {
+                            dropped.push_back(std::move(it->job));
+                            it = queue.erase(it);
+                        }
+                        else
+                            ++it;
+                    }
+                }
+            }
+
+            for (auto &job : dropped)
+                finish(job, nullptr, CURLE_ABORTED_BY_CALLBACK);
+
+            for (auto it = active_.begin(); it != active_.end();)
+            {
+                if (std::find(ids.begin(), ids.end(), it->second.id) == ids.end())
+                {
+                    ++it;
+                    continue;
+                }
+
+                CURL *handle = it->first;
+                size_t slot = it->second.key_slot;
+                FetchJob job = std::move(it->second.job);
+                it = active_.erase(it);
+
+                curl_multi_remove_handle(multi_, handle);
+                KeyPool::instance().release(slot, Outcome::cancelled, 0);
+                finish(job, handle, CURLE_ABORTED_BY_CALLBACK);
+                park(handle);
+            }
+        }
+
+        static void report(CURL *handle, CURLcode code, size_t key_slot)
+        {
+            long status = 0;
+            curl_off_t total_us = 0;
+            curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &status);
+            curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME_T, &total_us);
+            ConnectionStats::instance().record(handle);
+
+            bool transport_ok = code == CURLE_OK || code == CURLE_HTTP_RETURNED_ERROR;
+            auto outcome = classify_outcome(transport_ok, code == CURLE_OPERATION_TIMEDOUT, status);
+            KeyPool::instance().release(key_slot, outcome, total_us / 1000.0);
+        }
+
+        // how long the loop may sleep before a queued job is due
+        int poll_timeout_ms()
+        {
+            long long timeout_ms = 1000;
+            bool due = false;
+            auto now = Clock::now();
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (const auto &queue : pending_)
+                {
+                    for (const auto &entry : queue)
+                    {
+                        if (entry.deadline != Clock::time_point::max())
+                        {
+                            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(entry.deadline - now).count() + 1;
+                            timeout_ms = std::min<long long>(timeout_ms, std::max<long long>(left, 0));
+                        }
+
+                        if (entry.not_before <= now)
+                        {
+                            due = true;
+                            continue;
+                        }
+                        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(entry.not_before - now).count() + 1;
+                        timeout_ms = std::min<long long>(timeout_ms, wait);
+                    }
+                }
+            }
+
+            // due jobs are waiting for a token or a free slot
+            if (due)
+                timeout_ms = std::min<long long>(timeout_ms, KeyPool::instance().wait_hint().count());
+            return static_cast<int>(timeout_ms);
+        }
+
+        static void finish(FetchJob &job, CURL *handle, CURLcode code)
+        {
+            try
+            {
+                job.done(handle, code);
+            }
+            catch (const std::exception &ex)
+            {
+                std::cerr << "[fetch loop] " << ex.what() << std::endl;
+            }
+            catch (...)
+            {
+                std::cerr << "[fetch loop] unknown error in a job callback" << std::endl;
+            }
+        }
+
+        static void fail(FetchJob &job, std::exception_ptr error)
+        {
+            if (!job.failed)
+            {
+                finish(job, nullptr, CURLE_FAILED_INIT);
+                return;
+            }
+            try
+            {
+                job.failed(error);
+            }
+            catch (const std::exception &ex)
+            {
+                std::cerr << "[fetch loop] " << ex.what() << std::endl;
+            }
+            catch (...)
+            {
+                std::cerr << "[fetch loop] unknown error in a job callback" << std::endl;
+            }
+        }
+
+        void run()
+        {
+            while (true)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (stop_)
+                        break;
+                }
+
+                while (idle_.size() > idle_capacity_)
+                {
+                    curl_easy_cleanup(idle_.back());
+                    idle_.pop_back();
+                }
+
+                cancel_requested();
+                start_pending();
+
+                int running = 0;
+                curl_multi_perform(multi_, &running);
+
+                // a finished transfer frees a slot, start the next one right away
+                if (collect_done() > 0)
+                    continue;
+
+                curl_multi_poll(multi_, nullptr, 0, poll_timeout_ms(), nullptr);
+            }
+        }
+    };
+
+}
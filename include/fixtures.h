@@ -0,0 +1,108 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Sermet Pekin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "query_key.h"
+
+namespace evds
+{
+
+    // .................................................................. FixtureStore
+    /*
+    Recorded responses for offline runs, one file per request:
+
+        <dir>/<query_key>.json     body as EVDS sent it
+        <dir>/index.txt            "<file> <url>" per recorded request
+
+    Files are named by the stable hash of the canonical query, so a
+    fixture recorded on one machine replays on another, also for
+    another spelling of the same request (B-A for A-B).
+
+    URLs carry no API key (it travels in a header), so fixtures are safe
+    to share.
+    */
+    class FixtureStore
+    {
+    public:
+        explicit FixtureStore(const std::string &dir) : dir_(dir)
+        {
+        }
+
+        static std::string file_name(const std::string &url)
+        {
+            return query_key(url) + ".json";
+        }
+
+        std::optional<std::string> load(const std::string &url) const
+        {
+            std::ifstream file(path(url), std::ios::in | std::ios::binary);
+            if (!file)
+                return std::nullopt;
+
+            return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        }
+
+        void save(const std::string &url, const std::string &body) const
+        {
+            std::filesystem::create_directories(dir_);
+
+            // written aside and renamed, a replay never sees half a fixture
+            std::string target = path(url);
+            std::string tmp = target + ".tmp";
+            {
+                std::ofstream file(tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+                if (!file)
+                    throw std::runtime_error("Could not open fixture file for writing: " + tmp);
+                file.write(body.data(), static_cast<std::streamsize>(body.size()));
+            }
+            std::filesystem::rename(tmp, target);
+
+            static std::mutex index_mutex;
+            std::lock_guard<std::mutex> lock(index_mutex);
+            std::ofstream index(dir_ + "/index.txt", std::ios::out | std::ios::app);
+            index << file_name(url) << " " << url << "\n";
+        }
+
+    private:
+        std::string dir_;
+
+        std::string path(const std::string &url) const
+        {
+            return dir_ + "/" + file_name(url);
+        }
+    };
+
+}
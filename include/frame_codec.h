@@ -0,0 +1,309 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <typeindex>
+#include <vector>
+
+#include "dataframe.h"
+
+namespace evds
+{
+
+    // .................................................................. frame codec
+    /*
+    Binary columnar encoding of a DataFrame, for the parsed-frame cache:
+
+        "EVDF" u8 version, u32 columns, then for every column
+            u32 name length, name, u8 column type, u64 rows,
+            u8 layout : a cell kind when every cell has it, else mixed
+                        followed by one kind byte per row
+            values    : f64 / i64 as 8 bytes, strings as u32 length + bytes,
+                        nothing for missing cells
+
+    Integers are stored in host byte order, it is a local cache.
+    decode_frame throws std::runtime_error on anything it cannot read,
+    including counts that do not fit in the remaining bytes.
+    */
+    namespace frame_codec
+    {
+        constexpr char magic[4] = {'E', 'V', 'D', 'F'};
+        constexpr uint8_t version = 1;
+        constexpr uint8_t mixed = 0xFF;
+        // name length, type, rows and layout of an empty-named column
+        constexpr size_t column_header = 4 + 1 + 8 + 1;
+
+        enum Kind : uint8_t
+        {
+            none = 0,
+            number = 1,
+            integer = 2,
+            text = 3
+        };
+
+        // column_types: no type / monostate / double / long long / string
+        // fewest bytes a row of the layout takes, 0 for missing cells
+        size_t row_size(uint8_t layout)
+        {
+            switch (layout)
+            {
+            case mixed:
+                return 1;
+            case number:
+            case integer:
+                return 8;
+            case text:
+                return 4;
+            default:
+                return 0;
+            }
+        }
+
+        enum TypeTag : uint8_t
+        {
+            no_type = 0,
+            type_monostate = 1,
+            type_double = 2,
+            type_integer = 3,
+            type_string = 4
+        };
+
+        uint8_t type_tag(const std::optional<std::type_index> &type)
+        {
+            if (!type)
+                return no_type;
+            if (*type == typeid(std::monostate))
+                return type_monostate;
+            if (*type == typeid(double))
+                return type_double;
+            if (*type == typeid(long long))
+                return type_integer;
+            if (*type == typeid(std::string))
+                return type_string;
+            return no_type;
+        }
+
+        std::optional<std::type_index> tag_type(uint8_t tag)
+        {
+            switch (tag)
+            {
+            case type_monostate:
+                return std::type_index(typeid(std::monostate));
+            case type_double:
+                return std::type_index(typeid(double));
+            case type_integer:
+                return std::type_index(typeid(long long));
+            case type_string:
+                return std::type_index(typeid(std::string));
+            default:
+                return std::nullopt;
+            }
+        }
+
+        uint8_t kind(const Cell &cell)
+        {
+            return static_cast<uint8_t>(cell.index()); // monostate, double, long long, string
+        }
+
+        template <typename T>
+        void put(std::string &out, T value)
+        {
+            out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+
+        class Reader
+        {
+        public:
+            explicit Reader(const std::string &data) : data_(data) {}
+
+            template <typename T>
+            T get()
+            {
+                T value;
+                std::memcpy(&value, take(sizeof(T)), sizeof(T));
+                return value;
+            }
+
+            std::string get_string()
+            {
+                uint32_t size = get<uint32_t>();
+                return std::string(take(size), size);
+            }
+
+            const char *take(size_t n)
+            {
+                if (n > data_.size() - pos_)
+                    throw std::runtime_error("Cached frame is truncated");
+                const char *p = data_.data() + pos_;
+                pos_ += n;
+                return p;
+            }
+
+            bool at_end() const
+            {
+                return pos_ == data_.size();
+            }
+
+            size_t remaining() const
+            {
+                return data_.size() - pos_;
+            }
+
+        private:
+            const std::string &data_;
+            size_t pos_ = 0;
+        };
+    }
+
+    bool is_encoded_frame(const std::string &data)
+    {
+        return data.size() >= sizeof(frame_codec::magic) && std::memcmp(data.data(), frame_codec::magic, sizeof(frame_codec::magic)) == 0;
+    }
+
+    std::string encode_frame(const DataFrame &df)
+    {
+        using namespace frame_codec;
+
+        std::string out(magic, sizeof(magic));
+        put<uint8_t>(out, version);
+        put<uint32_t>(out, static_cast<uint32_t>(df.columns.size()));
+
+        for (const auto &[name, column] : df.columns)
+        {
+            put<uint32_t>(out, static_cast<uint32_t>(name.size()));
+            out += name;
+
+            auto type = df.column_types.find(name);
+            put<uint8_t>(out, type_tag(type != df.column_types.end() ? type->second : std::nullopt));
+            put<uint64_t>(out, column.size());
+
+            uint8_t layout = column.empty() ? static_cast<uint8_t>(none) : kind(column.front());
+            for (const auto &cell : column)
+            {
+                if (kind(cell) != layout)
+                {
+                    layout = mixed;
+                    break;
+                }
+            }
+
+            put<uint8_t>(out, layout);
+            if (layout == mixed)
+            {
+                for (const auto &cell : column)
+                    put<uint8_t>(out, kind(cell));
+            }
+
+            for (const auto &cell : column)
+            {
+                if (const auto *d = std::get_if<double>(&cell))
+                    put<double>(out, *d);
+                else if (const auto *i = std::get_if<long long>(&cell))
+                    put<int64_t>(out, *i);
+                else if (const auto *s = std::get_if<std::string>(&cell))
+                {
+                    put<uint32_t>(out, static_cast<uint32_t>(s->size()));
+                    out += *s;
+                }
+            }
+        }
+        return out;
+    }
+
+    DataFrame decode_frame(const std::string &data)
+    {
+        using namespace frame_codec;
+
+        if (!is_encoded_frame(data))
+            throw std::runtime_error("Not an encoded frame");
+
+        Reader reader(data);
+        reader.take(sizeof(magic));
+        if (reader.get<uint8_t>() != version)
+            throw std::runtime_error("Unsupported frame encoding version");
+
+        DataFrame df;
+        uint32_t columns = reader.get<uint32_t>();
+        if (columns > reader.remaining() / column_header)
+            throw std::runtime_error("Cached frame is truncated");
+        for (uint32_t c = 0; c < columns; ++c)
+        {
+            std::string name = reader.get_string();
+            df.column_types[name] = tag_type(reader.get<uint8_t>());
+
+            uint64_t rows = reader.get<uint64_t>();
+            uint8_t layout = reader.get<uint8_t>();
+            if (layout > text && layout != mixed)
+                throw std::runtime_error("Cached frame has an unknown cell kind");
+
+            // rows comes from disk: it must fit in what is left before anything is
+            // reserved. Missing cells take no bytes, but a real frame's date column
+            // does, so no column has more rows than the frame has bytes.
+            size_t size = row_size(layout);
+            if (size ? rows > reader.remaining() / size : rows > data.size())
+                throw std::runtime_error("Cached frame is truncated");
+
+            const char *kinds = nullptr;
+            if (layout == mixed)
+                kinds = reader.take(rows);
+
+            Column &column = df.columns[name];
+            column.reserve(rows);
+            for (uint64_t row = 0; row < rows; ++row)
+            {
+                switch (kinds ? static_cast<uint8_t>(kinds[row]) : layout)
+                {
+                case none:
+                    column.emplace_back(std::monostate{});
+                    break;
+                case number:
+                    column.emplace_back(reader.get<double>());
+                    break;
+                case integer:
+                    column.emplace_back(static_cast<long long>(reader.get<int64_t>()));
+                    break;
+                case text:
+                    column.emplace_back(reader.get_string());
+                    break;
+                default:
+                    throw std::runtime_error("Cached frame has an unknown cell kind");
+                }
+            }
+        }
+
+        if (!reader.at_end())
+            throw std::runtime_error("Cached frame has trailing data");
+        return df;
+    }
+
+}
@@ -0,0 +1,172 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "cache.h"
+#include "types.h"
+
+namespace evds
+{
+
+    // .................................................................. frequency_code
+    // the codes of UrlBuilder's frequency parameter, 0 for default and unknown names
+    uint32_t frequency_code(const std::string &frequency)
+    {
+        static const std::unordered_map<std::string, uint32_t> codes = {
+            {"daily", 1},
+            {"business", 2},
+            {"weekly", 3},
+            {"semimonthly", 4},
+            {"monthly", 5},
+            {"quarterly", 6},
+            {"semiannually", 7},
+            {"annual", 8},
+            {"annually", 8}};
+
+        auto it = codes.find(frequency);
+        return it == codes.end() ? 0 : it->second;
+    }
+
+    // one observation period, default counts as daily like most native frequencies
+    int period_days(uint32_t code)
+    {
+        static const int days[] = {1, 1, 1, 7, 15, 30, 91, 182, 365};
+        return code < std::size(days) ? days[code] : 1;
+    }
+
+    // .................................................................. entry_meta
+    // metadata of an entry fetched now with config
+    EntryMeta entry_meta(const Config &config, std::optional<std::chrono::sys_days> last_observation = std::nullopt)
+    {
+        EntryMeta meta = EntryMeta::now();
+        meta.frequency = frequency_code(config.frequency);
+        if (last_observation)
+            meta.last_observation = static_cast<int32_t>(last_observation->time_since_epoch().count());
+        return meta;
+    }
+
+    // .................................................................. entry_ttl
+    /*
+    How long an entry stays fresh after its fetch: one observation period
+    of its frequency, so daily data goes stale daily and annual data once
+    a year. Data ending more than three periods before the fetch (a
+    closed window, a discontinued series) only changes by revisions and
+    stays fresh for at least historic_ttl.
+    */
+    constexpr std::chrono::seconds historic_ttl = std::chrono::days(30);
+
+    std::chrono::seconds entry_ttl(const EntryMeta &meta)
+    {
+        int period = period_days(meta.frequency);
+        std::chrono::seconds ttl = std::chrono::days(period);
+
+        if (meta.last_observation != EntryMeta::unknown_day)
+        {
+            int64_t fetched_day = meta.fetched_at / 86400;
+            if (fetched_day - meta.last_observation > 3 * period)
+                ttl = std::max(ttl, historic_ttl);
+        }
+        return ttl;
+    }
+
+    // entries without metadata (written before it existed) count as stale
+    bool is_stale(const EntryMeta &meta, int64_t now = EntryMeta::now().fetched_at)
+    {
+        return meta.fetched_at <= 0 || now - meta.fetched_at >= entry_ttl(meta).count();
+    }
+
+    // .................................................................. Revalidator
+    /*
+    Book keeping of stale-while-revalidate: stale entries are served
+    right away and refreshed in the background, at most one refresh per
+    entry at a time. main() waits for the refreshes still running before
+    it returns.
+    */
+    class Revalidator
+    {
+    public:
+        static Revalidator &instance()
+        {
+            static Revalidator revalidator;
+            return revalidator;
+        }
+
+        // false when key is already being refreshed
+        bool begin(const std::string &key)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++served_;
+            return running_.insert(key).second;
+        }
+
+        void end(const std::string &key, bool ok)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                running_.erase(key);
+                ++(ok ? refreshed_ : failed_);
+            }
+            idle_.notify_all();
+        }
+
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            idle_.wait(lock, [this]
+                       { return running_.empty(); });
+        }
+
+        std::string str()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::ostringstream oss;
+            oss << "[stale] served: " << served_ << " refreshed: " << refreshed_ << " failed: " << failed_;
+            return oss.str();
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable idle_;
+        std::unordered_set<std::string> running_;
+        size_t served_ = 0;
+        size_t refreshed_ = 0;
+        size_t failed_ = 0;
+    };
+
+}
@@ -28,11 +28,28 @@
 #include "dotenv_.h"
 
 #include <curl/curl.h>
+#include <cstring>
+
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 #include "../extern/nlohmann/json.hpp"
 
 #include "header.h"
 #include "cache.h"
+#include "pool.h"
+#include "fetch_loop.h"
+#include "key_pool.h"
+#include "retry.h"
+#include "fixtures.h"
+#include "query_key.h"
+#include "freshness.h"
 
 using namespace evds;
 
@@ -51,20 +68,109 @@ struct is_cstring<char *> : std::true_type
 {
 };
 
-struct CurlDeleter
+struct CurlSlistDeleter
 {
-    void operator()(CURL *ptr) const
+    void operator()(curl_slist *ptr) const
     {
-        curl_easy_cleanup(ptr);
+        curl_slist_free_all(ptr);
     }
 };
 
+// ...................................................... ResponseData
+/*
+Growable sink for the response body.
+
+Capacity grows geometrically so a large body costs amortized O(n) copies,
+and it is reserved up front when the server sends Content-Length.
+take() moves the bytes out, the caller gets them without another copy.
+
+When on_data is set every chunk is also handed to it as it arrives
+(streaming parse). keep_body = false skips buffering altogether.
+*/
 struct ResponseData
 {
-    std::unique_ptr<char[]> memory;
-    size_t size = 0;
+    using Stream = std::function<void(const char *, size_t)>;
+
+    std::string body;
+    Stream on_data;
+    bool keep_body = true;
+    std::exception_ptr error;
+
+    // bytes after content decoding, see TransferStats
+    size_t decoded_bytes = 0;
+
+    static constexpr size_t max_reserve = 256 * 1024 * 1024;
+
+    void reserve(size_t expected)
+    {
+        if (keep_body && expected > body.capacity())
+            body.reserve(std::min(expected, max_reserve));
+    }
+
+    void append(const char *data, size_t n)
+    {
+        decoded_bytes += n;
+
+        if (on_data)
+            on_data(data, n);
+
+        if (!keep_body)
+            return;
+
+        size_t needed = body.size() + n;
+        if (needed > body.capacity())
+            body.reserve(std::max(needed, body.capacity() * 2));
+
+        body.append(data, n);
+    }
+
+    size_t size() const
+    {
+        return body.size();
+    }
+
+    std::string take()
+    {
+        if (error)
+            std::rethrow_exception(error);
+        return std::move(body);
+    }
+};
+
+// ...................................................... TransferStats
+/*
+Body bytes as they came over the wire (compressed) and after curl decoded
+them. Logged for every request so the saving of gzip/deflate is visible.
+*/
+struct TransferStats
+{
+    curl_off_t wire_bytes = 0;
+    size_t decoded_bytes = 0;
+
+    double ratio() const
+    {
+        return wire_bytes > 0 ? static_cast<double>(decoded_bytes) / static_cast<double>(wire_bytes) : 1.0;
+    }
 };
 
+TransferStats transfer_stats(CURL *curl, const ResponseData &chunk)
+{
+    TransferStats stats;
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &stats.wire_bytes);
+    stats.decoded_bytes = chunk.decoded_bytes;
+    return stats;
+}
+
+void log_transfer_stats(const std::string &url, const TransferStats &stats)
+{
+    std::ostringstream oss;
+    oss << "[bytes] wire: " << stats.wire_bytes
+        << " decoded: " << stats.decoded_bytes
+        << " ratio: " << std::fixed << std::setprecision(1) << stats.ratio() << "x"
+        << " " << url << "\n";
+    std::cout << oss.str();
+}
+
 struct GetParams
 {
     std::string url;
@@ -72,6 +178,13 @@ struct GetParams
     std::string proxy_url;
     bool cache = false;
     bool verbose = false;
+
+    // per attempt, 0 : no limit
+    long timeout_ms = 0;
+    long connect_timeout_ms = 0;
+
+    // optional streaming consumer of the body, see ResponseData
+    ResponseData::Stream on_data;
 };
 
 // ...................................................... WriteCallback
@@ -81,18 +194,45 @@ size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp)
     size_t realsize = size * nmemb;
     auto *mem = reinterpret_cast<ResponseData *>(userp);
 
-    auto new_memory = std::make_unique<char[]>(mem->size + realsize + 1);
-    if (!new_memory)
+    try
+    {
+        mem->append(static_cast<const char *>(contents), realsize);
+    }
+    catch (...)
+    {
+        // aborts the transfer, take() rethrows the real error
+        mem->error = std::current_exception();
         return 0;
+    }
 
-    if (mem->memory)
-        std::memcpy(new_memory.get(), mem->memory.get(), mem->size);
+    return realsize;
+}
 
-    std::memcpy(new_memory.get() + mem->size, contents, realsize);
-    mem->size += realsize;
-    new_memory[mem->size] = 0;
+// ...................................................... HeaderCallback
+// reserves the body buffer once Content-Length is known
+size_t HeaderCallback(char *buffer, size_t size, size_t nitems, void *userp)
+{
+    size_t realsize = size * nitems;
+    auto *mem = reinterpret_cast<ResponseData *>(userp);
 
-    mem->memory = std::move(new_memory);
+    static const std::string name("content-length:");
+    if (realsize > name.size())
+    {
+        std::string line(buffer, realsize);
+        std::transform(line.begin(), line.begin() + name.size(), line.begin(), ::tolower);
+
+        if (line.compare(0, name.size(), name) == 0)
+        {
+            try
+            {
+                mem->reserve(std::stoull(line.substr(name.size())));
+            }
+            catch (const std::exception &)
+            {
+                // malformed header, the buffer just grows on demand
+            }
+        }
+    }
 
     return realsize;
 }
@@ -118,42 +258,194 @@ std::enable_if_t<is_cstring<T>::value, const char *> get_proxy_for_url(T url, T
     return "";
 }
 
-std::string get_request_real(const GetParams &params, bool test, bool auto_confirm);
+using CurlHeaders = std::unique_ptr<curl_slist, CurlSlistDeleter>;
 
-std::string get_request(const GetParams &params, const Config &config)
+// ...................................................... configure_request
+// options shared by blocking transfers and FetchLoop transfers
+CurlHeaders configure_request(CURL *curl, const GetParams &params, ResponseData &chunk)
 {
+    std::cout << "url: " << params.url << "\n";
+    curl_easy_setopt(curl, CURLOPT_URL, params.url.c_str());
 
-    bool cache_option = config.cache;
+    // Prepare the header with the API key
+    CurlHeaders headers;
+    headers.reset(curl_slist_append(headers.release(), "Content-Type: application/json"));
 
-    Cache cache; // ("./.caches");
-    std::string cached_result;
-    std::string fnc_name("get_request_real");
+    std::string api_key_header = "key: " + params.api_key;
+    headers.reset(curl_slist_append(headers.release(), api_key_header.c_str()));
+
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers.get());
+
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, params.timeout_ms);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, params.connect_timeout_ms);
 
-    std::vector<std::string> v = {params.url, params.api_key, params.proxy_url};
-    std::string delim("_");
-    std::string params_str = evds::join(v, delim);
+    // 4xx / 5xx end the transfer before the error page reaches on_data or the cache
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
 
-    if (cache_option && cache.check_and_load_cache(fnc_name, cached_result, params_str))
+    // "" asks for every encoding this libcurl can decode (gzip, deflate, ...)
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    // the body is still buffered when it has to go to the cache
+    chunk.on_data = params.on_data;
+    chunk.keep_body = !params.on_data || params.cache;
+
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &chunk);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &chunk);
+
+    const char *proxy_url_env = get_proxy_for_url(params.url.c_str(), params.proxy_url.c_str());
+    if (proxy_url_env && std::strlen(proxy_url_env) > 0)
     {
-        std::cout << evds::divider();
-        std::cout << "Loaded data from cache." << std::endl;
-        std::cout << evds::divider();
+        curl_easy_setopt(curl, CURLOPT_PROXY, proxy_url_env);
+    }
 
-        return cached_result;
+    return headers;
+}
+
+// ...................................................... transfer_error
+// the exception a failed transfer ends with, write callback errors first
+std::exception_ptr transfer_error(CURL *curl, CURLcode res, const ResponseData &chunk)
+{
+    if (chunk.error)
+        return chunk.error;
+
+    long status = 0;
+    if (curl)
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+
+    if (res == CURLE_HTTP_RETURNED_ERROR)
+        return std::make_exception_ptr(TransferError("HTTP " + std::to_string(status) + " from EVDS", res, status));
+
+    return std::make_exception_ptr(TransferError(curl_easy_strerror(res), res, status));
+}
+
+bool is_transient(std::exception_ptr error)
+{
+    try
+    {
+        std::rethrow_exception(error);
+    }
+    catch (const TransferError &ex)
+    {
+        return ex.transient();
     }
+    catch (...)
+    {
+        return false;
+    }
+}
 
-    if (!config.auto_confirm)
-        throw std::runtime_error("[2]Something is wrong with auto confirm");
+std::string error_message(std::exception_ptr error)
+{
+    try
+    {
+        std::rethrow_exception(error);
+    }
+    catch (const std::exception &ex)
+    {
+        return ex.what();
+    }
+    catch (...)
+    {
+        return "unknown error";
+    }
+}
 
-    auto res = get_request_real(params, config.test, config.auto_confirm);
-    if (cache_option)
-        cache.save_cache(fnc_name, res, params_str);
-    return res;
+void log_retry(const std::string &url, int failures, std::chrono::milliseconds delay, std::exception_ptr error)
+{
+    std::ostringstream oss;
+    oss << "[retry] attempt " << failures + 1 << " in " << delay.count() << " ms after: "
+        << error_message(error) << " " << url << "\n";
+    std::cerr << oss.str();
 }
-std::string get_request_real(const GetParams &params, bool test, bool auto_confirm)
+
+// ...................................................... response cache
+static const std::string cache_fnc_name("get_request_real");
+
+// the canonical query (see canonical_query): no API key or proxy, the
+// same for every spelling of the request and shared by all users
+std::string request_cache_key(const GetParams &params)
+{
+    return canonical_query(params.url);
+}
+
+void revalidate_response(const GetParams &params, const Config &config);
+
+/*
+With on_data the entry is inflated straight into it and result stays
+empty. A stale entry (see entry_ttl) is a miss, or with
+stale_while_revalidate served while revalidate_response refreshes it.
+*/
+bool load_cached_response(const GetParams &params, const Config &config, std::string &result)
+{
+    if (!config.cache || config.refresh)
+        return false;
+
+    std::string key = request_cache_key(params);
+    auto meta = Cache::instance().load_cache_meta(cache_fnc_name, key);
+    bool stale = meta && is_stale(*meta);
+    if (stale && !config.stale_while_revalidate)
+        return false;
+
+    bool found = params.on_data ? Cache::instance().check_and_stream_cache(cache_fnc_name, params.on_data, key)
+                                : Cache::instance().check_and_load_cache(cache_fnc_name, result, key);
+    if (!found)
+        return false;
+
+    std::cout << evds::divider();
+    std::cout << (stale ? "Loaded stale data from cache, refreshing it." : "Loaded data from cache.") << std::endl;
+    std::cout << evds::divider();
+
+    if (stale)
+        revalidate_response(params, config);
+    return true;
+}
+
+void save_cached_response(const GetParams &params, const Config &config, const std::string &result)
+{
+    if (!config.cache)
+        return;
+
+    Cache::instance().save_cache_meta(entry_meta(config), cache_fnc_name, result, request_cache_key(params));
+}
+
+// ...................................................... api_keys
+/*
+Keys for the KeyPool, read once: EVDS_APIKEYS (comma separated) or
+EVDS_APIKEY from the environment in test mode, from .env otherwise.
+*/
+const std::vector<std::string> &api_keys(const Config &config)
 {
- 
+    static std::mutex mutex;
+    static std::vector<std::string> keys;
 
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!keys.empty())
+        return keys;
+
+    if (config.test)
+    {
+        const char *env_apikeys = std::getenv("EVDS_APIKEYS");
+        const char *env_apikey = std::getenv("EVDS_APIKEY");
+        if (env_apikeys && std::strlen(env_apikeys) > 0)
+            keys = split_api_keys(env_apikeys);
+        else if (env_apikey)
+            keys = {std::string(env_apikey)};
+        else
+            throw std::runtime_error("Environment variable EVDS_APIKEY is not set.");
+    }
+    else
+    {
+        keys = get_api_keys();
+    }
+
+    if (keys.empty())
+        keys = {""};
+    return keys;
+}
+
+std::string get_request_real(const GetParams &params, bool test, bool auto_confirm)
+{
     if (!auto_confirm && !test && !evds::confirm("Request?", params.url, params.verbose))
     {
         std::cout << "Not requesting ...";
@@ -164,51 +456,689 @@ std::string get_request_real(const GetParams &params, bool test, bool auto_confi
     CURLcode res;
     ResponseData chunk;
 
-    if (curl_global_init(CURL_GLOBAL_DEFAULT) != 0)
+    auto lease = ConnectionPool::instance().acquire();
+    CURL *curl = lease.get();
+
+    // the key comes from the KeyPool, params.api_key only when it has none
+    auto &keys = KeyPool::instance();
+    size_t slot = keys.acquire();
+
+    GetParams keyed = params;
+    if (!keys.key(slot).empty())
+        keyed.api_key = keys.key(slot);
+
+    auto headers = configure_request(curl, keyed, chunk);
+    res = curl_easy_perform(curl);
+
+    long status = 0;
+    curl_off_t total_us = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total_us);
+    ConnectionStats::instance().record(curl);
+    keys.release(slot, classify_outcome(res == CURLE_OK || res == CURLE_HTTP_RETURNED_ERROR, res == CURLE_OPERATION_TIMEDOUT, status),
+                 total_us / 1000.0);
+
+    if (res != CURLE_OK)
+        std::rethrow_exception(transfer_error(curl, res, chunk));
+
+    log_transfer_stats(params.url, transfer_stats(curl, chunk));
+
+    return chunk.take();
+}
+
+// ...................................................... fetch_blocking
+// one request on the calling thread, with get_request's retries
+std::string fetch_blocking(const GetParams &params, const Config &config)
+{
+    ConnectionPool::instance().set_capacity(config.pool_size);
+    KeyPool::instance().configure(config, api_keys(config));
+
+    GetParams real_params = params;
+    real_params.cache = config.cache;
+    real_params.timeout_ms = config.timeout_ms;
+    real_params.connect_timeout_ms = config.connect_timeout_ms;
+
+    // a body that already went partly to on_data cannot be fetched again
+    bool streamed = false;
+    if (params.on_data)
+    {
+        real_params.on_data = [&params, &streamed](const char *data, size_t n)
+        {
+            streamed = true;
+            params.on_data(data, n);
+        };
+    }
+
+    Deadline deadline = request_deadline(config);
+
+    RetryPolicy policy(config);
+    for (int failures = 1;; ++failures)
+    {
+        if (expired(deadline))
+            throw DeadlineExceeded(params.url);
+        real_params.timeout_ms = attempt_timeout_ms(config.timeout_ms, deadline);
+
+        try
+        {
+            return get_request_real(real_params, config.test, config.auto_confirm);
+        }
+        catch (const TransferError &ex)
+        {
+            if (expired(deadline))
+                throw DeadlineExceeded(params.url);
+            if (streamed || !ex.transient() || !policy.allows(failures))
+                throw;
+
+            auto delay = policy.delay(failures);
+            if (expired(deadline - delay))
+                throw DeadlineExceeded(params.url);
+
+            log_retry(params.url, failures, delay, std::current_exception());
+            std::this_thread::sleep_for(delay);
+        }
+    }
+}
+
+// done(error, body), see get_request_cb
+using ResponseCallback = std::function<void(std::exception_ptr, std::string)>;
+
+// ...................................................... AsyncRequest
+/*
+One EVDS request on the FetchLoop, with its retries and hedged twin.
+
+Transient failures are attempted again after RetryPolicy::delay. With
+config.hedge a duplicate is started once the first attempt has been
+running for the p95 latency of recent requests; the first attempt that
+succeeds wins and the other one is cancelled. When streaming, the first
+attempt that delivers bytes owns on_data and the other one is cancelled
+right away. A stream that broke midway is not retried, the consumer
+already saw part of it.
+
+Every attempt is bounded by the request deadline (request_deadline):
+queued attempts expire in the FetchLoop, running ones through
+CURLOPT_TIMEOUT_MS, and the request then fails with DeadlineExceeded.
+*/
+class AsyncRequest : public std::enable_shared_from_this<AsyncRequest>
+{
+public:
+    AsyncRequest(const GetParams &params, const Config &config, ResponseCallback done)
+        : params_(params), config_(config), done_(std::move(done)), policy_(config), deadline_(request_deadline(config)),
+          priority_(priority_class(config.priority))
     {
-        throw std::runtime_error("Failed to initialize curl.");
+        params_.cache = config.cache;
+        params_.timeout_ms = config.timeout_ms;
+        params_.connect_timeout_ms = config.connect_timeout_ms;
     }
 
-    std::unique_ptr<CURL, CurlDeleter> curl(curl_easy_init());
-    if (curl)
+    void start()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        launch(std::chrono::milliseconds(0), config_.hedge);
+    }
+
+private:
+    struct Attempt
+    {
+        FetchLoop::JobId id = 0;
+        ResponseData chunk;
+        CurlHeaders headers;
+        bool cancelled = false;
+    };
+    using AttemptPtr = std::shared_ptr<Attempt>;
+
+    GetParams params_;
+    Config config_;
+    ResponseCallback done_;
+    RetryPolicy policy_;
+    Deadline deadline_;
+    Priority priority_;
+
+    std::mutex mutex_;
+    std::vector<AttemptPtr> running_;
+    const Attempt *stream_owner_ = nullptr;
+    int failures_ = 0;
+    bool finished_ = false;
+
+    // mutex_ held
+    void launch(std::chrono::milliseconds delay, bool hedge)
+    {
+        auto self = shared_from_this();
+        auto attempt = std::make_shared<Attempt>();
+
+        FetchJob job;
+        job.priority = priority_;
+        job.setup = [self, attempt, hedge](CURL *curl, const std::string &api_key)
+        {
+            std::cout << "[requesting]";
+            attempt->headers = configure_request(curl, self->attempt_params(attempt, api_key), attempt->chunk);
+            if (hedge)
+                self->schedule_hedge();
+        };
+        job.done = [self, attempt](CURL *curl, CURLcode res)
+        {
+            self->on_done(attempt, curl, res);
+        };
+        job.failed = [self, attempt](std::exception_ptr error)
+        {
+            self->on_failed(attempt, error);
+        };
+
+        running_.push_back(attempt);
+        attempt->id = FetchLoop::instance().submit(std::move(job), delay, deadline_);
+    }
+
+    void schedule_hedge()
+    {
+        auto p95 = LatencyTracker::instance().percentile(0.95);
+        if (!p95)
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!finished_)
+            launch(std::chrono::milliseconds(static_cast<long>(*p95)), false);
+    }
+
+    GetParams attempt_params(const AttemptPtr &attempt, const std::string &api_key)
+    {
+        GetParams params = params_;
+        if (!api_key.empty())
+            params.api_key = api_key;
+        params.timeout_ms = attempt_timeout_ms(config_.timeout_ms, deadline_);
+        if (params_.on_data)
+        {
+            auto self = shared_from_this();
+            params.on_data = [self, attempt](const char *data, size_t n)
+            {
+                self->forward(attempt, data, n);
+            };
+        }
+        return params;
+    }
+
+    void forward(const AttemptPtr &attempt, const char *data, size_t n)
+    {
+        std::vector<FetchLoop::JobId> others;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!stream_owner_)
+            {
+                stream_owner_ = attempt.get();
+                others = cancel_others(attempt);
+            }
+            if (stream_owner_ != attempt.get())
+                throw std::runtime_error("superseded by a hedged request");
+        }
+
+        for (auto id : others)
+            FetchLoop::instance().cancel(id);
+
+        params_.on_data(data, n);
+    }
+
+    // mutex_ held, marks every other running attempt as cancelled
+    std::vector<FetchLoop::JobId> cancel_others(const AttemptPtr &attempt)
+    {
+        std::vector<FetchLoop::JobId> ids;
+        for (auto &other : running_)
+        {
+            if (other != attempt && !other->cancelled)
+            {
+                other->cancelled = true;
+                ids.push_back(other->id);
+            }
+        }
+        return ids;
+    }
+
+    // the attempt could not be set up: no retry, the request ends unless a twin runs
+    void on_failed(const AttemptPtr &attempt, std::exception_ptr error)
     {
-        std::cout << "url: " << params.url << "\n";
-        curl_easy_setopt(curl.get(), CURLOPT_URL, params.url.c_str());
+        std::vector<FetchLoop::JobId> others;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_.erase(std::remove(running_.begin(), running_.end(), attempt), running_.end());
+
+            if (finished_ || attempt->cancelled || !running_.empty())
+                return;
 
-        // Prepare the header with the API key
-        struct curl_slist *headers = nullptr;
-        headers = curl_slist_append(headers, "Content-Type: application/json");
+            finished_ = true;
+            others = cancel_others(attempt);
+        }
 
-        std::string api_key_header = "key: " + params.api_key;
-        headers = curl_slist_append(headers, api_key_header.c_str());
+        for (auto id : others)
+            FetchLoop::instance().cancel(id);
 
-        curl_easy_setopt(curl.get(), CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &chunk);
+        done_(error, "");
+    }
 
-        const char *proxy_url_env = get_proxy_for_url(params.url.c_str(), params.proxy_url.c_str());
-        if (proxy_url_env && std::strlen(proxy_url_env) > 0)
+    void on_done(const AttemptPtr &attempt, CURL *curl, CURLcode res)
+    {
+        std::exception_ptr error;
+        std::string body;
+        std::vector<FetchLoop::JobId> others;
         {
-            curl_easy_setopt(curl.get(), CURLOPT_PROXY, proxy_url_env);
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_.erase(std::remove(running_.begin(), running_.end(), attempt), running_.end());
+
+            if (finished_ || attempt->cancelled)
+                return;
+
+            if (res == CURLE_OK)
+            {
+                log_transfer_stats(params_.url, transfer_stats(curl, attempt->chunk));
+
+                curl_off_t total_us = 0;
+                curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total_us);
+                LatencyTracker::instance().record(total_us / 1000.0);
+
+                try
+                {
+                    body = attempt->chunk.take();
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+            }
+            else
+            {
+                error = transfer_error(curl, res, attempt->chunk);
+
+                // the hedged twin may still make it
+                if (!running_.empty())
+                    return;
+
+                bool streamed = stream_owner_ != nullptr;
+                if (expired(deadline_))
+                {
+                    error = std::make_exception_ptr(DeadlineExceeded(params_.url));
+                }
+                else if (!streamed && is_transient(error) && policy_.allows(failures_ + 1))
+                {
+                    auto delay = policy_.delay(failures_ + 1);
+                    if (expired(deadline_ - delay))
+                    {
+                        error = std::make_exception_ptr(DeadlineExceeded(params_.url));
+                    }
+                    else
+                    {
+                        ++failures_;
+                        log_retry(params_.url, failures_, delay, error);
+                        launch(delay, false);
+                        return;
+                    }
+                }
+            }
+
+            finished_ = true;
+            others = cancel_others(attempt);
         }
 
-        res = curl_easy_perform(curl.get());
+        for (auto id : others)
+            FetchLoop::instance().cancel(id);
+
+        if (error)
+            done_(error, "");
+        else
+            done_(nullptr, std::move(body));
+    }
+};
+
+// ...................................................... Transport
+/*
+How a request reaches EVDS, chosen by config.transport:
+
+    curl   : libcurl, blocking or on the FetchLoop (default)
+    record : curl, and every response is saved to config.fixture_dir
+    replay : responses come from config.fixture_dir after
+             config.replay_latency_ms, no network at all
+
+The response cache sits in front of every transport.
+*/
+class Transport
+{
+public:
+    virtual ~Transport() = default;
+
+    virtual std::string get(const GetParams &params, const Config &config) = 0;
+    virtual void get_cb(const GetParams &params, const Config &config, ResponseCallback done) = 0;
+};
+
+class CurlTransport : public Transport
+{
+public:
+    std::string get(const GetParams &params, const Config &config) override
+    {
+        return fetch_blocking(params, config);
+    }
 
-        if (res != CURLE_OK)
+    void get_cb(const GetParams &params, const Config &config, ResponseCallback done) override
+    {
+        auto &keys = KeyPool::instance();
+        // everything that may throw before done is handed over
+        try
         {
-            throw std::runtime_error(curl_easy_strerror(res));
+            priority_class(config.priority);
+            keys.configure(config, api_keys(config));
         }
+        catch (...)
+        {
+            done(std::current_exception(), "");
+            return;
+        }
+        FetchLoop::instance().set_max_in_flight(max_jobs(config) * keys.size());
+        FetchLoop::instance().set_idle_capacity(config.pool_size);
 
-        curl_slist_free_all(headers);
+        std::make_shared<AsyncRequest>(params, config, std::move(done))->start();
     }
-    else
+};
+
+class RecordTransport : public Transport
+{
+public:
+    std::string get(const GetParams &params, const Config &config) override
+    {
+        auto tee = std::make_shared<std::string>();
+        std::string body = curl_.get(teed(params, tee), config);
+
+        FixtureStore(config.fixture_dir).save(params.url, params.on_data ? *tee : body);
+        return body;
+    }
+
+    void get_cb(const GetParams &params, const Config &config, ResponseCallback done) override
+    {
+        auto tee = std::make_shared<std::string>();
+        bool streaming = static_cast<bool>(params.on_data);
+
+        curl_.get_cb(teed(params, tee), config, [tee, streaming, url = params.url, dir = config.fixture_dir, done](std::exception_ptr error, std::string body)
+                     {
+                         if (!error)
+                         {
+                             try
+                             {
+                                 FixtureStore(dir).save(url, streaming ? *tee : body);
+                             }
+                             catch (...)
+                             {
+                                 error = std::current_exception();
+                             }
+                         }
+                         done(error, std::move(body)); });
+    }
+
+private:
+    CurlTransport curl_;
+
+    // a streamed body is not buffered by curl, keep a copy for the fixture
+    static GetParams teed(const GetParams &params, std::shared_ptr<std::string> tee)
+    {
+        GetParams copy = params;
+        if (params.on_data)
+        {
+            copy.on_data = [tee, on_data = params.on_data](const char *data, size_t n)
+            {
+                tee->append(data, n);
+                on_data(data, n);
+            };
+        }
+        return copy;
+    }
+};
+
+class ReplayTransport : public Transport
+{
+public:
+    std::string get(const GetParams &params, const Config &config) override
     {
-        throw std::runtime_error("curl_easy_init() failed.");
+        std::string body = load(params, config);
+        std::this_thread::sleep_for(latency(config));
+        feed(params, body);
+        return body;
     }
 
-    curl_global_cleanup();
+    void get_cb(const GetParams &params, const Config &config, ResponseCallback done) override
+    {
+        std::string body;
+        try
+        {
+            body = load(params, config);
+        }
+        catch (...)
+        {
+            done(std::current_exception(), "");
+            return;
+        }
+
+        auto reply = [params, body = std::move(body), done]() mutable
+        {
+            try
+            {
+                feed(params, body);
+            }
+            catch (...)
+            {
+                done(std::current_exception(), "");
+                return;
+            }
+            done(nullptr, std::move(body));
+        };
+        FetchLoop::instance().schedule(std::move(reply), latency(config));
+    }
+
+private:
+    static std::string load(const GetParams &params, const Config &config)
+    {
+        auto body = FixtureStore(config.fixture_dir).load(params.url);
+        if (!body)
+            throw std::runtime_error("No recorded response in " + config.fixture_dir + " for " + params.url);
+
+        std::cout << "[replay] " << params.url << "\n";
+        return std::move(*body);
+    }
+
+    static std::chrono::milliseconds latency(const Config &config)
+    {
+        return std::chrono::milliseconds(static_cast<long>(std::max(config.replay_latency_ms, 0.0)));
+    }
+
+    // in pieces the size of a typical curl write, like a live transfer
+    static void feed(const GetParams &params, const std::string &body)
+    {
+        if (!params.on_data)
+            return;
+
+        constexpr size_t piece = 16 * 1024;
+        for (size_t pos = 0; pos < body.size(); pos += piece)
+            params.on_data(body.data() + pos, std::min(piece, body.size() - pos));
+    }
+};
 
-    return std::string(chunk.memory.get(), chunk.size);
+Transport &select_transport(const Config &config)
+{
+    static CurlTransport curl;
+    static RecordTransport record;
+    static ReplayTransport replay;
+
+    if (config.transport == "curl")
+        return curl;
+    if (config.transport == "record")
+        return record;
+    if (config.transport == "replay")
+        return replay;
+
+    throw std::runtime_error("Unknown transport: " + config.transport + " (curl | record | replay)");
+}
+
+// ...................................................... get_request
+std::string get_request(const GetParams &params, const Config &config)
+{
+    std::string cached_result;
+    if (load_cached_response(params, config, cached_result))
+        return cached_result;
+
+    if (!config.auto_confirm)
+        throw std::runtime_error("[2]Something is wrong with auto confirm");
+
+    auto res = select_transport(config).get(params, config);
+    save_cached_response(params, config, res);
+    return res;
+}
+
+// ...................................................... get_request_cb
+/*
+Same as get_request but asynchronous: with the curl transport the
+transfer runs on the shared FetchLoop. Each API key's RateLimiter decides
+how many of its transfers are in flight: config.jobs, or up to a larger
+config.max_jobs while EVDS answers quickly. The rest wait in the loop's
+queue of their config.priority class.
+
+done(error, body) is called exactly once: on the loop thread when the
+transfer finishes, or right away on the calling thread for cache hits and
+for errors before the transfer is queued (no transport, no API key).
+*/
+void get_request_cb(const GetParams &params, const Config &config, ResponseCallback done)
+{
+    std::string cached_result;
+    bool cached = false;
+    Transport *transport = nullptr;
+    try
+    {
+        cached = load_cached_response(params, config, cached_result);
+        if (!cached)
+        {
+            if (!config.auto_confirm)
+                throw std::runtime_error("[2]Something is wrong with auto confirm");
+            transport = &select_transport(config);
+        }
+    }
+    catch (...)
+    {
+        done(std::current_exception(), {});
+        return;
+    }
+
+    if (cached)
+    {
+        done(nullptr, std::move(cached_result));
+        return;
+    }
+
+    transport->get_cb(params, config, [params, config, done = std::move(done)](std::exception_ptr error, std::string body)
+                                    {
+                                        if (!error)
+                                        {
+                                            try
+                                            {
+                                                save_cached_response(params, config, body);
+                                            }
+                                            catch (...)
+                                            {
+                                                error = std::current_exception();
+                                            }
+                                        }
+                                        done(error, std::move(body)); });
+}
+
+// ...................................................... revalidate_response
+// refetches a stale response on the bulk queue, the caller already has the stale one
+void revalidate_response(const GetParams &params, const Config &config)
+{
+    std::string key = cache_fnc_name + request_cache_key(params);
+    if (!Revalidator::instance().begin(key))
+        return;
+
+    GetParams refresh_params = params;
+    refresh_params.on_data = nullptr;
+
+    Config refresh = config;
+    refresh.refresh = true;
+    refresh.priority = "bulk";
+
+    try
+    {
+        get_request_cb(refresh_params, refresh, [key](std::exception_ptr error, std::string)
+                       { Revalidator::instance().end(key, !error); });
+    }
+    catch (...)
+    {
+        Revalidator::instance().end(key, false);
+    }
+}
+
+// ...................................................... warm_up
+/*
+Opens the first connection to EVDS (DNS, TCP, TLS) with a HEAD request
+on the FetchLoop while the caller is still planning. Later transfers
+find the DNS entry and TLS session in the CurlShare and the connection
+in the loop's cache. Failures only get logged, the real requests will
+report them.
+*/
+void warm_up(const Config &config)
+{
+    if (!config.warm_up || config.transport == "replay")
+        return;
+
+    auto &keys = KeyPool::instance();
+    try
+    {
+        keys.configure(config, api_keys(config));
+    }
+    catch (const std::exception &ex)
+    {
+        // no API key: the requests themselves report it
+        std::cout << "[warm-up] skipped: " << ex.what() << "\n";
+        return;
+    }
+    auto &loop = FetchLoop::instance();
+    loop.set_max_in_flight(max_jobs(config) * keys.size());
+    loop.set_idle_capacity(config.pool_size);
+
+    FetchJob job;
+    job.priority = Priority::interactive;
+    job.setup = [config](CURL *curl, const std::string &)
+    {
+        curl_easy_setopt(curl, CURLOPT_URL, evds::domain.c_str());
+        curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, config.connect_timeout_ms);
+
+        std::string no_proxy;
+        const char *proxy_url = get_proxy_for_url(evds::domain.c_str(), no_proxy.c_str());
+        if (proxy_url && std::strlen(proxy_url) > 0)
+            curl_easy_setopt(curl, CURLOPT_PROXY, proxy_url);
+    };
+    job.done = [](CURL *curl, CURLcode res)
+    {
+        if (res == CURLE_ABORTED_BY_CALLBACK)
+            return;
+
+        curl_off_t connect_us = 0;
+        if (curl)
+            curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &connect_us);
+
+        std::ostringstream oss;
+        if (res == CURLE_OK)
+            oss << "[warm-up] connected to " << evds::domain << " in " << connect_us / 1000 << " ms\n";
+        else
+            oss << "[warm-up] " << curl_easy_strerror(res) << "\n";
+        std::cout << oss.str();
+    };
+    loop.submit(std::move(job));
+}
+
+// ...................................................... get_request_async
+std::future<std::string> get_request_async(const GetParams &params, const Config &config)
+{
+    auto promise = std::make_shared<std::promise<std::string>>();
+    auto future = promise->get_future();
+
+    get_request_cb(params, config, [promise](std::exception_ptr error, std::string body)
+                   {
+                       if (error)
+                           promise->set_exception(error);
+                       else
+                           promise->set_value(std::move(body)); });
+
+    return future;
 }
 
 void write_response_to_file(const std::string &content, const std::string &filename)
@@ -244,45 +1174,39 @@ std::string read_content_from_file(const std::string &filename)
     return buffer.str();
 }
 
-std::string getEvds(const std::string &url, const Config &config)
+GetParams make_params(const std::string &url, const Config &config)
 {
+    GetParams params;
+    params.url = url;
+    params.verbose = config.verbose;
+    params.cache = config.cache;
 
-    try
-    {
-        GetParams params;
-        params.url = url;
-        params.verbose = config.verbose;
-        const char *env_apikey = std::getenv("EVDS_APIKEY");
+    // the KeyPool picks a key per transfer, this one is the fallback
+    params.api_key = api_keys(config).front();
 
-        if (config.test)
-        {
+    params.proxy_url = "";
+    return params;
+}
 
-            if (env_apikey)
-            {
-                params.api_key = std::string(env_apikey);
-            }
-            else
-            {
-                std::cerr << "Environment variable EVDS_APIKEY is not set." << std::endl;
-                return "";
-            }
-        }
-        else
-        {
-            params.api_key = get_api_key();
-        }
+std::string getEvds(const std::string &url, const Config &config, ResponseData::Stream on_data = nullptr)
+{
+    GetParams params = make_params(url, config);
+    params.on_data = std::move(on_data);
 
-        params.proxy_url = "";
+    // errors reach the caller as they are, after get_request's retries
+    return get_request(params, config);
+}
 
-        std::string response = get_request(params, config);
+void getEvds_cb(const std::string &url, const Config &config, ResponseCallback done, ResponseData::Stream on_data = nullptr)
+{
+    GetParams params = make_params(url, config);
+    params.on_data = std::move(on_data);
+    get_request_cb(params, config, std::move(done));
+}
 
-        return response;
-    }
-    catch (const std::exception &ex)
-    {
-        // std::cerr << "Error: " << ex.what() << std::endl;
-    }
-    throw std::runtime_error("Request was cancelled");
-    // return nullptr;
-    return "";
+std::future<std::string> getEvds_async(const std::string &url, const Config &config, ResponseData::Stream on_data = nullptr)
+{
+    GetParams params = make_params(url, config);
+    params.on_data = std::move(on_data);
+    return get_request_async(params, config);
 }
@@ -28,11 +28,22 @@
 #include <cstdio> // for sprintf
 #include "header.h"
 #include "json.h"
+#include "frame_codec.h"
 #include "series.h"
 #include "dataframe.h"
 #include "url_builder.h"
 #include "get.h"
 #include "shorten.h"
+#include "date_range.h"
+#include "single_flight.h"
+#include "range_cache.h"
+
+#include <chrono>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
 
 using namespace evds;
 
@@ -61,7 +72,7 @@ struct deduce_series_type<std::string>
     using type = std::optional<std::string>;
 };
 
-DataFrame get_series(std::string &str, const Config &config = Config(), bool verbose = false)
+std::string series_url(std::string &str, const Config &config = Config(), bool verbose = false)
 {
 
     // str = normalizeDelimiters(str );
@@ -77,12 +88,12 @@ DataFrame get_series(std::string &str, const Config &config = Config(), bool ver
     if (verbose)
         std::cout << "Generated URL: " << url << std::endl;
 
-    DataFrame df;
-
-    std::string res;
+    return url;
+}
 
- 
-    res = getEvds(url, config);
+DataFrame parse_series(const std::string &res)
+{
+    DataFrame df;
 
     json parsed_json = json::parse(res);
 
@@ -95,6 +106,797 @@ DataFrame get_series(std::string &str, const Config &config = Config(), bool ver
     return df;
 }
 
+// ...................................................... fetch_url_cb
+/*
+One request for an already built URL, parsed according to config.stream.
+done(error, df) is called once, usually on the FetchLoop thread.
+*/
+using SeriesCallback = std::function<void(std::exception_ptr, DataFrame)>;
+
+void fetch_url_cb_impl(const std::string &url, const Config &config, const SeriesCallback &done)
+{
+    if (!config.stream)
+    {
+        getEvds_cb(url, config, [done](std::exception_ptr error, std::string body)
+                   {
+                       DataFrame df;
+                       if (!error)
+                       {
+                           try
+                           {
+                               df = parse_series(body);
+                           }
+                           catch (...)
+                           {
+                               error = std::current_exception();
+                           }
+                       }
+                       done(error, std::move(df)); });
+        return;
+    }
+
+    // items go into the DataFrame while the body is still downloading
+    auto parser = std::make_shared<evds::ItemStreamParser>();
+    getEvds_cb(
+        url, config, [parser, done](std::exception_ptr error, std::string)
+        {
+            if (!error)
+            {
+                try
+                {
+                    parser->finish();
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+            }
+            done(error, error ? DataFrame() : parser->take()); },
+        [parser](const char *data, size_t n)
+        { parser->feed(data, n); });
+}
+
+// ...................................................... frame cache
+/*
+Second cache tier next to the raw responses of get_request: the parsed
+DataFrame of a request, binary encoded (encode_frame). A hit decodes
+straight into typed columns without touching JSON. Entries that do not
+decode count as misses.
+
+A frame is as old as the response it was parsed from. Stale frames (see
+entry_ttl) are misses, or with stale_while_revalidate returned with
+`stale` set, fetch_url_cb then refreshes both tiers in the background.
+*/
+static const std::string frame_cache_fnc_name("parsed_frame");
+
+bool load_cached_frame(const std::string &key, const Config &config, DataFrame &df, bool &stale)
+{
+    if (!config.cache || config.refresh)
+        return false;
+
+    auto meta = Cache::instance().load_cache_meta(frame_cache_fnc_name, key);
+    stale = meta && is_stale(*meta);
+    if (stale && !config.stale_while_revalidate)
+        return false;
+
+    std::string body;
+    if (!Cache::instance().check_and_load_cache(frame_cache_fnc_name, body, key))
+        return false;
+
+    try
+    {
+        df = decode_frame(body);
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << "[cache] ignoring a cached frame: " << ex.what() << std::endl;
+        return false;
+    }
+
+    std::cout << evds::divider();
+    std::cout << (stale ? "Loaded stale parsed data from cache, refreshing it." : "Loaded parsed data from cache.") << std::endl;
+    std::cout << evds::divider();
+    return true;
+}
+
+void save_cached_frame(const std::string &key, const Config &config, const DataFrame &df)
+{
+    if (!config.cache)
+        return;
+
+    EntryMeta meta = entry_meta(config, last_observation(df));
+    if (auto response = Cache::instance().load_cache_meta(cache_fnc_name, key))
+        meta.fetched_at = response->fetched_at;
+    Cache::instance().save_cache_meta(meta, frame_cache_fnc_name, encode_frame(df), key);
+}
+
+// refetches a stale frame on the bulk queue, the caller already has the stale one
+void revalidate_frame(const std::string &url, const std::string &key, const Config &config)
+{
+    std::string refresh_key = frame_cache_fnc_name + key;
+    if (!Revalidator::instance().begin(refresh_key))
+        return;
+
+    Config refresh = config;
+    refresh.refresh = true;
+    refresh.priority = "bulk";
+
+    auto save = [refresh_key, key, refresh](std::exception_ptr error, DataFrame df)
+    {
+        if (!error)
+        {
+            try
+            {
+                save_cached_frame(key, refresh, df);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+        }
+        Revalidator::instance().end(refresh_key, !error);
+    };
+
+    try
+    {
+        fetch_url_cb_impl(url, refresh, save);
+    }
+    catch (...)
+    {
+        save(std::current_exception(), DataFrame());
+    }
+}
+
+/*
+Concurrent calls for the same request share one fetch (SingleFlight), so
+fan-out over overlapping index groups costs one transfer and one cache
+write per URL. Calls with another deadline or other retry settings do
+not join it. With config.cache the parsed frame is looked up first.
+*/
+// joiners only share a fetch that gives up when they would: same deadline and retries
+std::string flight_key(const std::string &key, const Config &config)
+{
+    std::ostringstream oss;
+    oss << key << "|" << config.deadline.time_since_epoch().count() << "|" << config.deadline_ms
+        << "|" << config.retries << "|" << config.retry_base_ms << "|" << config.retry_max_ms
+        << "|" << config.timeout_ms << "|" << config.connect_timeout_ms;
+    return oss.str();
+}
+
+void fetch_url_cb(const std::string &url, const Config &config, SeriesCallback done)
+{
+    auto &flights = SingleFlight<DataFrame>::instance();
+
+    std::string key;
+    std::string flight;
+    try
+    {
+        key = request_cache_key(make_params(url, config));
+        flight = flight_key(key, config);
+    }
+    catch (...)
+    {
+        done(std::current_exception(), DataFrame());
+        return;
+    }
+
+    if (!flights.join(flight, std::move(done)))
+        return;
+
+    auto complete = [flight](std::exception_ptr error, DataFrame df)
+    {
+        SingleFlight<DataFrame>::instance().complete(flight, error, std::move(df));
+    };
+
+    try
+    {
+        DataFrame cached;
+        bool stale = false;
+        if (load_cached_frame(key, config, cached, stale))
+        {
+            complete(nullptr, std::move(cached));
+            if (stale)
+                revalidate_frame(url, key, config);
+            return;
+        }
+
+        fetch_url_cb_impl(url, config, [key, config, complete](std::exception_ptr error, DataFrame df)
+                          {
+                              if (!error)
+                              {
+                                  try
+                                  {
+                                      save_cached_frame(key, config, df);
+                                  }
+                                  catch (const std::exception &ex)
+                                  {
+                                      std::cerr << "[cache] " << ex.what() << std::endl;
+                                  }
+                              }
+                              complete(error, std::move(df)); });
+    }
+    catch (...)
+    {
+        complete(std::current_exception(), DataFrame());
+    }
+}
+
+// ...................................................... ChunkedFetch
+/*
+Fetches one index group as consecutive date chunks (see RangePlanner),
+up to config.jobs chunks at a time, and stitches them back into one
+DataFrame in date order.
+
+At the default frequency the native one is not known: the first chunk
+goes alone, and unless its rows are daily (daily_rows) the whole window
+is fetched as one request instead.
+*/
+class ChunkedFetch : public std::enable_shared_from_this<ChunkedFetch>
+{
+public:
+    ChunkedFetch(const std::string &str, const Config &config, const RangePlan &plan, SeriesCallback done)
+        : index_(str), config_(config), done_(std::move(done)),
+          planner_(plan.planned, plan.final_end, chunk_days(config.frequency), config.chunk_target_ms),
+          probing_(config.frequency == "default")
+    {
+    }
+
+    void start()
+    {
+        pump();
+    }
+
+private:
+    std::string index_;
+    Config config_;
+    SeriesCallback done_;
+
+    std::mutex mutex_;
+    RangePlanner planner_;
+    std::map<Days, DataFrame> parts_;
+    size_t in_flight_ = 0;
+    std::exception_ptr error_;
+    bool finished_ = false;
+    bool probing_; // until the first chunk shows daily rows
+
+    void pump()
+    {
+        while (true)
+        {
+            DateRange range;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (error_ || planner_.done() || in_flight_ >= (probing_ ? 1 : std::max<size_t>(config_.jobs, 1)) ||
+                    (probing_ && !parts_.empty()))
+                    break;
+
+                range = planner_.next();
+                ++in_flight_;
+            }
+            request(range);
+        }
+        maybe_finish();
+    }
+
+    void request(const DateRange &range)
+    {
+        Config chunk_config = config_;
+        chunk_config.start_date = format_date(range.start);
+        chunk_config.end_date = format_date(range.end);
+
+        auto self = shared_from_this();
+        auto started = std::chrono::steady_clock::now();
+
+        try
+        {
+            std::string url = evds::UrlBuilder(evds::Index(index_), chunk_config).get_url();
+            fetch_url_cb(url, chunk_config, [self, range, started](std::exception_ptr error, DataFrame df)
+                         { self->on_chunk(range, started, error, std::move(df)); });
+        }
+        catch (...)
+        {
+            on_chunk(range, started, std::current_exception(), DataFrame());
+        }
+    }
+
+    void on_chunk(const DateRange &range, std::chrono::steady_clock::time_point started, std::exception_ptr error, DataFrame df)
+    {
+        double latency_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        bool whole = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --in_flight_;
+
+            if (error)
+            {
+                if (!error_)
+                    error_ = error;
+            }
+            else if (probing_ && !daily_rows(df))
+            {
+                whole = !planner_.done();
+                finished_ = whole;
+                if (whole)
+                    parts_.clear();
+                else
+                    parts_[range.start] = std::move(df);
+            }
+            else
+            {
+                probing_ = false;
+                parts_[range.start] = std::move(df);
+                planner_.observe(range, latency_ms);
+            }
+        }
+
+        if (whole)
+        {
+            fetch_whole();
+            return;
+        }
+        pump();
+    }
+
+    // rows of another native frequency: chunk edges could cut their periods, one request
+    void fetch_whole()
+    {
+        try
+        {
+            std::string url = evds::UrlBuilder(evds::Index(index_), config_).get_url();
+            fetch_url_cb(url, config_, done_);
+        }
+        catch (...)
+        {
+            done_(std::current_exception(), DataFrame());
+        }
+    }
+
+    void maybe_finish()
+    {
+        std::vector<DataFrame> parts;
+        std::exception_ptr error;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (finished_ || in_flight_ > 0 || (!error_ && !planner_.done()))
+                return;
+
+            finished_ = true;
+            error = error_;
+            for (auto &[_, part] : parts_)
+                parts.push_back(std::move(part));
+        }
+
+        if (error)
+        {
+            done_(error, DataFrame());
+            return;
+        }
+
+        DataFrame df;
+        try
+        {
+            df = stitch_frames(parts);
+        }
+        catch (...)
+        {
+            done_(std::current_exception(), DataFrame());
+            return;
+        }
+        done_(nullptr, std::move(df));
+    }
+};
+
+// ...................................................... fetch_series_cb
+// the whole window of config, as chunks when it is long
+void fetch_series_cb(const std::string &str, const Config &config, SeriesCallback done)
+{
+    try
+    {
+        std::string index_str = str;
+
+        if (config.split)
+        {
+            evds::Index index(index_str);
+            auto plan = plan_range(config.start_date, config.end_date, config.frequency, config.formulas);
+
+            if (plan)
+            {
+                std::cout << "index1 : " << index.get() << " [" << config.start_date << " .. " << config.end_date << " in chunks]\n";
+                std::make_shared<ChunkedFetch>(index_str, config, *plan, done)->start();
+                return;
+            }
+        }
+
+        fetch_url_cb(series_url(index_str, config, config.verbose), config, done);
+    }
+    catch (...)
+    {
+        done(std::current_exception(), DataFrame());
+    }
+}
+
+// ...................................................... range cache
+/*
+With config.cache, windows of daily data go through the RangeStore,
+series by series:
+
+    cached 01-01-2000 .. 31-12-2025, asked 01-01-2020 .. 31-12-2022
+        -> sliced locally, no request
+    cached 01-01-2000 .. 31-12-2019, asked 01-01-2015 .. 31-12-2022
+        -> only 01-01-2020 .. 31-12-2022 is fetched
+
+A request for "TP.DK.USD.A-TP.DK.EUR.A" looks up each code on its own
+and only the codes with missing ranges go to the network, together when
+they miss the same ranges. The response is split per code (split_frame),
+every code is merged with the cached intervals it touches and the parts
+are joined by date again. Datagroups are one unit, their columns are
+also stored per series, so a later request for one of them hits.
+
+The gaps also go through the URL cache: rows that are not dd-mm-yyyy
+(quarterly or annual series at the default frequency) are not kept by the
+RangeStore, the URL cache still serves them the next time.
+A stale interval (see entry_ttl) is sliced all the same while a bulk
+request refetches it in the background, or without stale_while_revalidate
+refetched before the slice.
+
+config.incremental is meant for daily refresh jobs: stored intervals are
+never stale, only the days after them are requested and merged in:
+
+    stored 01-01-2000 .. 14-10-2026  ->  request startDate=15-10-2026
+
+Without config.cache nothing is stored and every window is fetched whole.
+*/
+class RangeFetch : public std::enable_shared_from_this<RangeFetch>
+{
+public:
+    RangeFetch(const std::string &str, const Config &config, const DateRange &wanted, SeriesCallback done)
+        : index_(str), config_(config), wanted_(wanted), done_(std::move(done))
+    {
+    }
+
+    void start()
+    {
+        std::vector<std::string> indexes = {index_};
+        if (!is_datagroup(index_))
+        {
+            indexes.clear();
+            for (const auto &code : series_codes(index_))
+                if (std::find(indexes.begin(), indexes.end(), code) == indexes.end())
+                    indexes.push_back(code);
+        }
+
+        std::map<std::string, size_t> group_of; // missing ranges -> group
+        for (const auto &index : indexes)
+        {
+            Unit unit;
+            unit.index = index;
+            unit.set = RangeStore::set_key(index, config_);
+            auto missing = lookup(unit);
+
+            if (!unit.result)
+            {
+                std::string gaps;
+                for (const auto &gap : missing)
+                    gaps += format_date(gap.start) + format_date(gap.end);
+
+                auto it = group_of.find(gaps);
+                if (it == group_of.end())
+                {
+                    it = group_of.emplace(gaps, groups_.size()).first;
+                    groups_.push_back(Group{{}, missing});
+                }
+                groups_[it->second].units.push_back(units_.size());
+            }
+            units_.push_back(std::move(unit));
+        }
+
+        for (const auto &group : groups_)
+            pending_ += group.gaps.size();
+
+        if (pending_ == 0)
+        {
+            finish();
+            return;
+        }
+
+        for (size_t g = 0; g < groups_.size(); ++g)
+        {
+            std::string codes = group_index(groups_[g]);
+            bool partial = groups_[g].units.size() < units_.size() || groups_[g].gaps.size() != 1 ||
+                           groups_[g].gaps[0].start != wanted_.start || groups_[g].gaps[0].end != wanted_.end;
+
+            for (const auto &gap : groups_[g].gaps)
+            {
+                Config gap_config = config_;
+                gap_config.start_date = format_date(gap.start);
+                gap_config.end_date = gap.end == wanted_.end ? config_.end_date : format_date(gap.end);
+
+                if (partial)
+                    std::cout << "[range cache] fetching " << codes << " " << gap_config.start_date << " .. " << gap_config.end_date << "\n";
+
+                auto self = shared_from_this();
+                fetch_series_cb(codes, gap_config, [self, g](std::exception_ptr error, DataFrame df)
+                                { self->on_gap(g, error, std::move(df)); });
+            }
+        }
+    }
+
+private:
+    // one series code, or a datagroup
+    struct Unit
+    {
+        std::string index;
+        std::string set;
+        DateRange interval{};              // wanted plus the cached intervals it touches
+        std::vector<DataFrame> parts;      // fetched rows first, then the cached intervals
+        EntryMeta meta;                    // of the merged rows, as old as the oldest interval
+        std::optional<DataFrame> result;   // rows of wanted
+    };
+
+    // units missing the same ranges, fetched by one request per range
+    struct Group
+    {
+        std::vector<size_t> units;
+        std::vector<DateRange> gaps;
+    };
+
+    std::string index_;
+    Config config_;
+    DateRange wanted_;
+    SeriesCallback done_;
+
+    std::vector<Unit> units_;
+    std::vector<Group> groups_;
+
+    std::mutex mutex_;
+    std::vector<std::pair<size_t, DataFrame>> fetched_; // group, response
+    size_t pending_ = 0;
+    std::exception_ptr error_;
+
+    // sets unit.result when the cache covers wanted, otherwise returns the ranges to fetch
+    std::vector<DateRange> lookup(Unit &unit)
+    {
+        auto found = lookup_range(RangeStore::intervals(unit.set), wanted_);
+        unit.meta = entry_meta(config_);
+
+        if (found.covering)
+        {
+            auto meta = RangeStore::meta(unit.set, *found.covering);
+            bool stale = !config_.incremental && (!meta || is_stale(*meta));
+
+            if (stale && !config_.stale_while_revalidate)
+            {
+                unit.interval = *found.covering;
+                return {*found.covering};
+            }
+
+            if (auto df = RangeStore::load(unit.set, *found.covering))
+            {
+                std::cout << "[range cache] " << unit.index << " " << config_.start_date << " .. " << config_.end_date
+                          << " sliced from " << format_date(found.covering->start) << " .. " << format_date(found.covering->end)
+                          << (stale ? " (stale, refreshing)" : "") << "\n";
+                unit.result = rows_between(*df, wanted_.start, wanted_.end);
+
+                if (stale)
+                    revalidate(unit, *found.covering);
+                return {};
+            }
+        }
+
+        unit.interval = wanted_;
+        for (const auto &cached : found.touching)
+        {
+            auto df = RangeStore::load(unit.set, cached);
+            if (!df)
+            {
+                // entry gone: fetch the whole window, the broken intervals are dropped
+                unit.parts.clear();
+                unit.interval = wanted_;
+                unit.meta = entry_meta(config_);
+                return {wanted_};
+            }
+            unit.parts.push_back(std::move(*df));
+            unit.interval.start = std::min(unit.interval.start, cached.start);
+            unit.interval.end = std::max(unit.interval.end, cached.end);
+
+            auto meta = RangeStore::meta(unit.set, cached);
+            unit.meta.fetched_at = std::min(unit.meta.fetched_at, meta ? meta->fetched_at : 0);
+        }
+        return found.missing;
+    }
+
+    // refetches a stale interval on the bulk queue
+    void revalidate(const Unit &unit, const DateRange &interval)
+    {
+        std::string key = unit.set + "|" + format_date(interval.start) + "|" + format_date(interval.end);
+        if (!Revalidator::instance().begin(key))
+            return;
+
+        Config refresh = config_;
+        refresh.start_date = format_date(interval.start);
+        refresh.end_date = format_date(interval.end);
+        refresh.cache = false;
+        refresh.priority = "bulk";
+
+        fetch_series_cb(unit.index, refresh, [key, set = unit.set, interval, meta = entry_meta(config_)](std::exception_ptr error, DataFrame df)
+                        {
+                            if (!error)
+                            {
+                                try
+                                {
+                                    RangeStore::merge(set, interval, df, meta);
+                                }
+                                catch (...)
+                                {
+                                    error = std::current_exception();
+                                }
+                            }
+                            Revalidator::instance().end(key, !error); });
+    }
+
+    std::string group_index(const Group &group) const
+    {
+        std::vector<std::string> indexes;
+        for (size_t u : group.units)
+            indexes.push_back(units_[u].index);
+        return evds::join(indexes, Index_delimiter);
+    }
+
+    void on_gap(size_t group, std::exception_ptr error, DataFrame df)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (error && !error_)
+                error_ = error;
+            if (!error)
+                fetched_.emplace_back(group, std::move(df));
+            if (--pending_ > 0)
+                return;
+        }
+
+        if (error_)
+        {
+            done_(error_, DataFrame());
+            return;
+        }
+        finish();
+    }
+
+    void finish()
+    {
+        DataFrame df;
+        try
+        {
+            // split the responses per series, fetched rows go in front of the cached ones
+            for (auto &[g, response] : fetched_)
+            {
+                const auto &members = groups_[g].units;
+                if (members.size() == 1)
+                {
+                    auto &parts = units_[members[0]].parts;
+                    parts.insert(parts.begin(), std::move(response));
+                    continue;
+                }
+
+                auto codes = series_codes(group_index(groups_[g]));
+                for (size_t u : members)
+                {
+                    auto &parts = units_[u].parts;
+                    parts.insert(parts.begin(), split_frame(response, {units_[u].index}, codes));
+                }
+            }
+
+            std::vector<DataFrame> results;
+            for (auto &unit : units_)
+            {
+                if (!unit.result)
+                {
+                    DataFrame merged = stitch_frames(unit.parts);
+                    RangeStore::record(unit.set, unit.interval, merged, unit.meta);
+                    unit.result = rows_between(merged, wanted_.start, wanted_.end);
+
+                    if (is_datagroup(unit.index))
+                        store_columns(*unit.result, unit.meta);
+                }
+                results.push_back(std::move(*unit.result));
+            }
+
+            df = results.size() == 1 ? std::move(results[0]) : join_frames(results);
+        }
+        catch (...)
+        {
+            done_(std::current_exception(), DataFrame());
+            return;
+        }
+        done_(nullptr, std::move(df));
+    }
+
+    // the columns of a datagroup response, each in the set of its series
+    void store_columns(const DataFrame &df, const EntryMeta &meta)
+    {
+        if (df.rows() > 0 && !last_observation(df))
+            return;
+
+        auto columns = column_series(df);
+        std::vector<std::string> codes;
+        for (const auto &[code, _] : columns)
+            codes.push_back(code);
+
+        for (const auto &code : codes)
+            RangeStore::merge(RangeStore::set_key(code, config_), wanted_, split_frame(df, {code}, codes), meta);
+    }
+};
+
+void range_series_cb(const std::string &str, const Config &config, SeriesCallback done)
+{
+    auto wanted = config.cache ? cacheable_range(config) : std::nullopt;
+    if (!wanted)
+    {
+        fetch_series_cb(str, config, std::move(done));
+        return;
+    }
+
+    std::make_shared<RangeFetch>(str, config, *wanted, std::move(done))->start();
+}
+
+// ...................................................... get_series_cb
+/*
+Asynchronous get_series: the request(s) are queued on the shared
+FetchLoop and done(error, df) is called once, on the loop thread (or
+right away for cache hits). Nothing blocks, many series can be in
+flight from a single caller thread.
+*/
+void get_series_cb(const std::string &str, const Config &config, SeriesCallback done)
+{
+    try
+    {
+        range_series_cb(str, config, done);
+    }
+    catch (...)
+    {
+        done(std::current_exception(), DataFrame());
+    }
+}
+
+// ...................................................... get_series_async
+/*
+Same as get_series_cb, the returned future yields the DataFrame or
+rethrows the error.
+
+    std::vector<std::future<DataFrame>> futures;
+    for (const auto &index : indexes)
+        futures.push_back(get_series_async(index, config));
+
+Do not wait on the future inside another callback of the FetchLoop,
+that thread is the one completing it.
+*/
+std::future<DataFrame> get_series_async(const std::string &str, const Config &config = Config())
+{
+    auto promise = std::make_shared<std::promise<DataFrame>>();
+    auto future = promise->get_future();
+
+    get_series_cb(str, config, [promise](std::exception_ptr error, DataFrame df)
+                  {
+                      if (error)
+                          promise->set_exception(error);
+                      else
+                          promise->set_value(std::move(df)); });
+
+    return future;
+}
+
+// ...................................................... get_series
+// blocking wrapper over get_series_async
+DataFrame get_series(const std::string &str, const Config &config = Config(), bool verbose = false)
+{
+    if (!verbose || config.verbose)
+        return get_series_async(str, config).get();
+
+    Config verbose_config = config;
+    verbose_config.verbose = true;
+    return get_series_async(str, verbose_config).get();
+}
+
 std::vector<double> check_df(DataFrame &df, const std::string &col)
 {
 
@@ -27,6 +27,8 @@
  */
 
 
+#pragma once
+
 #include <iostream>
 #include <vector>
 #include <string>
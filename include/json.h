@@ -26,6 +26,8 @@
  */
 
 
+#pragma once
+
 #include "../extern/nlohmann/json.hpp"
 #include "dataframe.h"
 #include <iostream>
@@ -67,6 +69,52 @@ namespace evds
         return str;  
     }
 
+    void add_json_string(const std::string &key, const std::string &str_value, DataFrame &df)
+    {
+        if (is_date_string(str_value))
+        {
+            if (str_value.find('-') != std::string::npos && str_value.size() > 7)
+            {
+                df.add_value(key, str_value); 
+                // Already in 'dd-mm-yyyy' format
+            }
+            else
+            {
+                df.add_value(key, convert_year_month_to_date(str_value)); 
+                // Convert 'yyyy-m' or 'yyyy-mm' to '01-mm-yyyy'
+            }
+        }
+        else
+        {
+            // Attempt  numeric type
+            try
+            {
+                if (str_value.find('.') != std::string::npos)
+                {
+                    //  possibly numeric =>  double
+                    double double_value = std::stod(str_value);
+                    df.add_value(key, double_value);
+                }
+                else
+                {
+                    // long long
+                    long long long_value = std::stoll(str_value);
+                    df.add_value(key, long_value);
+                }
+            }
+            catch (const std::invalid_argument &)
+            {
+                 
+                df.add_value(key, str_value);
+            }
+            catch (const std::out_of_range &)
+            {
+                
+                df.add_value(key, str_value);
+            }
+        }
+    }
+
     void parse_json_line(const nlohmann::json &j, DataFrame &df)
     {
         for (auto &[key, value] : j.items())
@@ -82,51 +130,7 @@ namespace evds
             }
             else if (value.is_string())
             {
-                std::string str_value = value.get<std::string>();
-
-              
-                if (is_date_string(str_value))
-                {
-                    if (str_value.find('-') != std::string::npos && str_value.size() > 7)
-                    {
-                        df.add_value(key, str_value); 
-                        // Already in 'dd-mm-yyyy' format
-                    }
-                    else
-                    {
-                        df.add_value(key, convert_year_month_to_date(str_value)); 
-                        // Convert 'yyyy-m' or 'yyyy-mm' to '01-mm-yyyy'
-                    }
-                }
-                else
-                {
-                    // Attempt  numeric type
-                    try
-                    {
-                        if (str_value.find('.') != std::string::npos)
-                        {
-                            //  possibly numeric =>  double
-                            double double_value = std::stod(str_value);
-                            df.add_value(key, double_value);
-                        }
-                        else
-                        {
-                            // long long
-                            long long long_value = std::stoll(str_value);
-                            df.add_value(key, long_value);
-                        }
-                    }
-                    catch (const std::invalid_argument &)
-                    {
-                         
-                        df.add_value(key, str_value);
-                    }
-                    catch (const std::out_of_range &)
-                    {
-                        
-                        df.add_value(key, str_value);
-                    }
-                }
+                add_json_string(key, value.get<std::string>(), df);
             }
             else if (value.is_number_integer())
             {
@@ -144,4 +148,261 @@ namespace evds
         nlohmann::json j = nlohmann::json::parse(line);
         parse_json_line(j, df);
     }
+
+    // ...................................................................... ItemSax
+    /*
+    SAX handler for a single element of "items".
+    Produces the same cells as parse_json_line without building a json DOM.
+    Nested values (UNIXTIME is an object) are skipped.
+    */
+    class ItemSax : public nlohmann::json_sax<nlohmann::json>
+    {
+    public:
+        explicit ItemSax(DataFrame &df) : df_(df) {}
+
+        bool null() override
+        {
+            if (at_field())
+                df_.add_value(key_, std::monostate{});
+            return true;
+        }
+
+        bool boolean(bool) override
+        {
+            return true;
+        }
+
+        bool number_integer(number_integer_t val) override
+        {
+            if (at_field())
+                df_.add_value(key_, static_cast<long long>(val));
+            return true;
+        }
+
+        bool number_unsigned(number_unsigned_t val) override
+        {
+            if (at_field())
+                df_.add_value(key_, static_cast<long long>(val));
+            return true;
+        }
+
+        bool number_float(number_float_t val, const string_t &) override
+        {
+            if (at_field())
+                df_.add_value(key_, static_cast<double>(val));
+            return true;
+        }
+
+        bool string(string_t &val) override
+        {
+            if (at_field())
+                add_json_string(key_, val, df_);
+            return true;
+        }
+
+        bool binary(binary_t &) override
+        {
+            return true;
+        }
+
+        bool start_object(std::size_t) override
+        {
+            ++depth_;
+            return true;
+        }
+
+        bool key(string_t &val) override
+        {
+            if (depth_ == 1)
+                key_ = val;
+            return true;
+        }
+
+        bool end_object() override
+        {
+            --depth_;
+            return true;
+        }
+
+        bool start_array(std::size_t) override
+        {
+            ++depth_;
+            return true;
+        }
+
+        bool end_array() override
+        {
+            --depth_;
+            return true;
+        }
+
+        bool parse_error(std::size_t position, const std::string &, const nlohmann::detail::exception &ex) override
+        {
+            throw std::runtime_error("Could not parse item at " + std::to_string(position) + ": " + ex.what());
+        }
+
+    private:
+        DataFrame &df_;
+        std::string key_;
+        int depth_ = 0;
+
+        bool at_field() const
+        {
+            return depth_ == 1 && key_ != "UNIXTIME";
+        }
+    };
+
+    // ...................................................................... ItemStreamParser
+    /*
+    Incremental parser for EVDS responses
+
+        {"totalCount": 2, "items": [{...}, {...}]}
+
+    feed() accepts the body in arbitrary pieces (e.g. straight from the curl
+    write callback). Every element of "items" is handed to ItemSax as soon
+    as its closing brace arrives, so parsing overlaps with the transfer and
+    only one item is buffered at a time.
+    */
+    class ItemStreamParser
+    {
+    public:
+        void feed(const char *data, size_t n)
+        {
+            for (size_t i = 0; i < n; ++i)
+                step(data[i]);
+        }
+
+        void feed(const std::string &data)
+        {
+            feed(data.data(), data.size());
+        }
+
+        // throws if the body ended in the middle of the document
+        void finish() const
+        {
+            if (!started_ || depth_ != 0 || in_string_)
+                throw std::runtime_error("Incomplete or invalid EVDS response");
+        }
+
+        DataFrame &frame()
+        {
+            return df_;
+        }
+
+        DataFrame take()
+        {
+            return std::move(df_);
+        }
+
+    private:
+        DataFrame df_;
+
+        int depth_ = 0;
+        bool started_ = false;
+        bool in_string_ = false;
+        bool escape_ = false;
+
+        // top level keys, to find "items"
+        std::string string_;
+        std::string last_key_;
+
+        bool in_items_ = false;
+        std::string item_;
+
+        void step(char c)
+        {
+            bool in_item = in_items_ && depth_ >= 3;
+
+            if (in_item || (in_items_ && depth_ == 2 && c == '{'))
+                item_.push_back(c);
+
+            if (in_string_)
+            {
+                if (escape_)
+                    escape_ = false;
+                else if (c == '\\')
+                    escape_ = true;
+                else if (c == '"')
+                {
+                    in_string_ = false;
+                    if (depth_ == 1)
+                        last_key_ = string_;
+                }
+                else if (depth_ == 1)
+                    string_.push_back(c);
+                return;
+            }
+
+            switch (c)
+            {
+            case '"':
+                in_string_ = true;
+                string_.clear();
+                break;
+            case '{':
+            case '[':
+                if (depth_ == 0 && c != '{')
+                    throw std::runtime_error("Unexpected EVDS response, expected an object");
+                if (depth_ == 1 && c == '[' && last_key_ == "items")
+                    in_items_ = true;
+                started_ = true;
+                ++depth_;
+                break;
+            case '}':
+            case ']':
+                --depth_;
+                if (depth_ < 0)
+                    throw std::runtime_error("Unbalanced EVDS response");
+                if (in_items_ && depth_ == 2)
+                    flush_item();
+                if (in_items_ && depth_ == 1)
+                    in_items_ = false;
+                break;
+            default:
+                if (depth_ == 0 && !std::isspace(static_cast<unsigned char>(c)))
+                    throw std::runtime_error("Unexpected EVDS response, expected an object");
+                break;
+            }
+        }
+
+        void flush_item()
+        {
+            ItemSax sax(df_);
+            nlohmann::json::sax_parse(item_, &sax);
+            item_.clear();
+        }
+    };
+
+    // ...................................................................... frame_to_items_json
+    /*
+    A DataFrame written back as an EVDS style body, {"items": [{...}, ...]},
+    one object per row. Reading it with parse_series or ItemStreamParser
+    gives the same cells back.
+    */
+    std::string frame_to_items_json(const DataFrame &df)
+    {
+        json items = json::array();
+
+        size_t rows = df.rows();
+        for (size_t row = 0; row < rows; ++row)
+        {
+            json item = json::object();
+            for (const auto &[name, column] : df.columns)
+            {
+                const Cell &cell = row < column.size() ? column[row] : Cell(std::monostate{});
+                std::visit([&item, &name](const auto &value)
+                           {
+                    using T = std::decay_t<decltype(value)>;
+                    if constexpr (std::is_same_v<T, std::monostate>)
+                        item[name] = nullptr;
+                    else
+                        item[name] = value; }, cell);
+            }
+            items.push_back(std::move(item));
+        }
+
+        json body;
+        body["items"] = std::move(items);
+        return body.dump();
+    }
 }
@@ -0,0 +1,174 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Sermet Pekin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "rate_limiter.h"
+
+namespace evds
+{
+
+    // .................................................................. KeyPool
+    /*
+    The API keys requests are spread over (EVDS_APIKEYS=a,b,c), each with
+    its own RateLimiter: token bucket, AIMD concurrency and error counts.
+    A 429 on one key slows that key down, the others keep their pace.
+
+    try_acquire() hands out the next key, round robin, that has a token and
+    a free slot. The caller reports back with release(slot, ...) once the
+    transfer ended.
+    */
+    class KeyPool
+    {
+    public:
+        static KeyPool &instance()
+        {
+            static KeyPool pool;
+            return pool;
+        }
+
+        // keys are only replaced when they changed, settings go to every key
+        void configure(const Config &config, const std::vector<std::string> &keys)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (keys != keys_)
+            {
+                keys_ = keys.empty() ? std::vector<std::string>{""} : keys;
+                limiters_.clear();
+                for (size_t i = 0; i < keys_.size(); ++i)
+                    limiters_.push_back(std::make_unique<RateLimiter>());
+                next_ = 0;
+            }
+            for (auto &limiter : limiters_)
+                limiter->configure(config);
+        }
+
+        size_t size()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return keys_.size();
+        }
+
+        std::string key(size_t slot)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return keys_.at(slot);
+        }
+
+        std::optional<size_t> try_acquire()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < limiters_.size(); ++i)
+            {
+                size_t slot = (next_ + i) % limiters_.size();
+                if (limiters_[slot]->try_acquire())
+                {
+                    next_ = slot + 1;
+                    return slot;
+                }
+            }
+            return std::nullopt;
+        }
+
+        // blocking, for the synchronous get_request path
+        size_t acquire()
+        {
+            while (true)
+            {
+                if (auto slot = try_acquire())
+                    return *slot;
+
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait_for(lock, wait_hint_locked());
+            }
+        }
+
+        void release(size_t slot, Outcome outcome, double latency_ms)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (slot < limiters_.size())
+                    limiters_[slot]->release(outcome, latency_ms);
+            }
+            cv_.notify_all();
+        }
+
+        // until the first key may have a token or a slot again
+        std::chrono::milliseconds wait_hint()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return wait_hint_locked();
+        }
+
+        // one "[rate]" line per key, keys are shown by position only
+        std::string metrics_str()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::ostringstream oss;
+            for (size_t i = 0; i < limiters_.size(); ++i)
+            {
+                if (i > 0)
+                    oss << "\n";
+                std::string line = limiters_[i]->metrics().str();
+                if (limiters_.size() > 1)
+                    line.insert(6, " key " + std::to_string(i + 1) + "/" + std::to_string(limiters_.size()));
+                oss << line;
+            }
+            return oss.str();
+        }
+
+    private:
+        KeyPool()
+        {
+            limiters_.push_back(std::make_unique<RateLimiter>());
+        }
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::vector<std::string> keys_{""};
+        std::vector<std::unique_ptr<RateLimiter>> limiters_;
+        size_t next_ = 0;
+
+        std::chrono::milliseconds wait_hint_locked()
+        {
+            auto hint = std::chrono::milliseconds(1000);
+            for (auto &limiter : limiters_)
+                hint = std::min(hint, limiter->wait_hint());
+            return hint;
+        }
+    };
+
+}
@@ -0,0 +1,184 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace evds
+{
+
+    // .................................................................. Hash128
+    struct Hash128
+    {
+        uint64_t h1 = 0;
+        uint64_t h2 = 0;
+
+        bool operator==(const Hash128 &other) const
+        {
+            return h1 == other.h1 && h2 == other.h2;
+        }
+
+        // 32 lowercase hex digits of the digest bytes (h1 then h2, little endian),
+        // as the reference implementation and mmh3 print them
+        std::string hex() const
+        {
+            static const char digits[] = "0123456789abcdef";
+            std::string out;
+            out.reserve(32);
+            for (uint64_t half : {h1, h2})
+            {
+                for (int i = 0; i < 8; ++i)
+                {
+                    unsigned byte = (half >> (8 * i)) & 0xff;
+                    out += digits[byte >> 4];
+                    out += digits[byte & 0xf];
+                }
+            }
+            return out;
+        }
+    };
+
+    struct Hash128Hasher
+    {
+        size_t operator()(const Hash128 &hash) const
+        {
+            return static_cast<size_t>(hash.h1);
+        }
+    };
+
+    // .................................................................. murmur3_128
+    /*
+    MurmurHash3_x64_128 (Austin Appleby, public domain). Blocks are read
+    as little endian on every platform, so the same bytes give the same
+    hash with any compiler, standard library or CPU: safe for names and
+    keys that are written to disk.
+    */
+    namespace murmur
+    {
+        constexpr uint64_t rotl(uint64_t x, int r)
+        {
+            return (x << r) | (x >> (64 - r));
+        }
+
+        constexpr uint64_t fmix(uint64_t k)
+        {
+            k ^= k >> 33;
+            k *= 0xff51afd7ed558ccdULL;
+            k ^= k >> 33;
+            k *= 0xc4ceb9fe1a85ec53ULL;
+            k ^= k >> 33;
+            return k;
+        }
+
+        uint64_t load_le(const unsigned char *p, size_t n = 8)
+        {
+            uint64_t value = 0;
+            for (size_t i = 0; i < n; ++i)
+                value |= static_cast<uint64_t>(p[i]) << (8 * i);
+            return value;
+        }
+    }
+
+    Hash128 murmur3_128(const void *key, size_t len, uint64_t seed = 0)
+    {
+        using namespace murmur;
+
+        const auto *data = static_cast<const unsigned char *>(key);
+        const size_t nblocks = len / 16;
+        const uint64_t c1 = 0x87c37b91114253d5ULL;
+        const uint64_t c2 = 0x4cf5ad432745937fULL;
+
+        uint64_t h1 = seed;
+        uint64_t h2 = seed;
+
+        for (size_t i = 0; i < nblocks; ++i)
+        {
+            uint64_t k1 = load_le(data + i * 16);
+            uint64_t k2 = load_le(data + i * 16 + 8);
+
+            k1 *= c1;
+            k1 = rotl(k1, 31);
+            k1 *= c2;
+            h1 ^= k1;
+            h1 = rotl(h1, 27);
+            h1 += h2;
+            h1 = h1 * 5 + 0x52dce729;
+
+            k2 *= c2;
+            k2 = rotl(k2, 33);
+            k2 *= c1;
+            h2 ^= k2;
+            h2 = rotl(h2, 31);
+            h2 += h1;
+            h2 = h2 * 5 + 0x38495ab5;
+        }
+
+        const unsigned char *tail = data + nblocks * 16;
+        size_t rest = len & 15;
+        uint64_t k1 = load_le(tail, rest < 8 ? rest : 8);
+        uint64_t k2 = rest > 8 ? load_le(tail + 8, rest - 8) : 0;
+
+        if (rest > 8)
+        {
+            k2 *= c2;
+            k2 = rotl(k2, 33);
+            k2 *= c1;
+            h2 ^= k2;
+        }
+        if (rest > 0)
+        {
+            k1 *= c1;
+            k1 = rotl(k1, 31);
+            k1 *= c2;
+            h1 ^= k1;
+        }
+
+        h1 ^= len;
+        h2 ^= len;
+
+        h1 += h2;
+        h2 += h1;
+
+        h1 = fmix(h1);
+        h2 = fmix(h2);
+
+        h1 += h2;
+        h2 += h1;
+
+        return Hash128{h1, h2};
+    }
+
+    Hash128 murmur3_128(const std::string &key, uint64_t seed = 0)
+    {
+        return murmur3_128(key.data(), key.size(), seed);
+    }
+
+}
@@ -0,0 +1,350 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Sermet Pekin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <curl/curl.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace evds
+{
+
+    // .................................................................. CurlGlobal
+    /*
+    curl_global_init is not thread safe and is costly, so it is done once
+    for the whole process and undone when the program exits.
+    */
+    class CurlGlobal
+    {
+    public:
+        static void ensure()
+        {
+            static CurlGlobal instance;
+        }
+
+        ~CurlGlobal()
+        {
+            curl_global_cleanup();
+        }
+
+    private:
+        CurlGlobal()
+        {
+            if (curl_global_init(CURL_GLOBAL_DEFAULT) != 0)
+            {
+                throw std::runtime_error("Failed to initialize curl.");
+            }
+        }
+    };
+
+    // .................................................................. CurlShare
+    /*
+    DNS cache and TLS session ids shared by every easy handle of the
+    process, pooled blocking handles and FetchLoop handles alike, so a
+    host is resolved once and later handshakes resume the TLS session.
+
+    Connections themselves are not put in the share: libcurl does not
+    support sharing the connection cache between concurrently running
+    threads. FetchLoop transfers share the multi handle's connection cache
+    instead, pooled handles keep their own.
+    */
+    class CurlShare
+    {
+    public:
+        static CurlShare &instance()
+        {
+            static CurlShare share;
+            return share;
+        }
+
+        CurlShare(const CurlShare &) = delete;
+        CurlShare &operator=(const CurlShare &) = delete;
+
+        ~CurlShare()
+        {
+            curl_share_cleanup(share_);
+        }
+
+        // after curl_easy_reset, which drops CURLOPT_SHARE
+        void attach(CURL *handle)
+        {
+            curl_easy_setopt(handle, CURLOPT_SHARE, share_);
+        }
+
+    private:
+        CurlShare()
+        {
+            CurlGlobal::ensure();
+            share_ = curl_share_init();
+            if (!share_)
+                throw std::runtime_error("curl_share_init() failed.");
+
+            curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, lock);
+            curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, unlock);
+            curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+            curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+            curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        }
+
+        CURLSH *share_ = nullptr;
+        std::mutex mutexes_[CURL_LOCK_DATA_LAST];
+
+        static void lock(CURL *, curl_lock_data data, curl_lock_access, void *userptr)
+        {
+            static_cast<CurlShare *>(userptr)->mutexes_[data].lock();
+        }
+
+        static void unlock(CURL *, curl_lock_data data, void *userptr)
+        {
+            static_cast<CurlShare *>(userptr)->mutexes_[data].unlock();
+        }
+    };
+
+    // .................................................................. ConnectionStats
+    /*
+    How often transfers found a live connection. Recorded for every
+    finished transfer, printed at the end of a run:
+
+        [connections] transfers: 40 reused: 36 (90.0%) new: 4 tls handshakes: 1 avg connect: 35.2 ms
+    */
+    class ConnectionStats
+    {
+    public:
+        static ConnectionStats &instance()
+        {
+            static ConnectionStats stats;
+            return stats;
+        }
+
+        void record(CURL *handle)
+        {
+            long connects = 0;
+            curl_off_t connect_us = 0, appconnect_us = 0;
+            curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &connects);
+            curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &connect_us);
+            curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &appconnect_us);
+
+            ++transfers_;
+            if (connects == 0)
+            {
+                ++reused_;
+                return;
+            }
+
+            new_connections_ += connects;
+            connect_us_ += connect_us;
+            if (appconnect_us > 0)
+                ++tls_handshakes_;
+        }
+
+        size_t transfers() const
+        {
+            return transfers_;
+        }
+
+        size_t reused() const
+        {
+            return reused_;
+        }
+
+        std::string str() const
+        {
+            size_t transfers = transfers_, reused = reused_, created = new_connections_;
+            double reuse_pct = transfers ? 100.0 * reused / transfers : 0.0;
+            double avg_connect_ms = created ? connect_us_ / 1000.0 / created : 0.0;
+
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(1)
+                << "[connections] transfers: " << transfers << " reused: " << reused << " (" << reuse_pct << "%)"
+                << " new: " << created << " tls handshakes: " << tls_handshakes_
+                << " avg connect: " << avg_connect_ms << " ms";
+            return oss.str();
+        }
+
+    private:
+        ConnectionStats() = default;
+
+        std::atomic<size_t> transfers_{0};
+        std::atomic<size_t> reused_{0};
+        std::atomic<size_t> new_connections_{0};
+        std::atomic<size_t> tls_handshakes_{0};
+        std::atomic<long long> connect_us_{0};
+    };
+
+    // .................................................................. ConnectionPool
+    /*
+    Process wide pool of curl easy handles.
+
+    A handle keeps its connection cache, DNS cache and TLS session ids
+    between transfers, so requests drawn from the pool reuse the
+    keep-alive connection to evds2.tcmb.gov.tr instead of paying a new
+    handshake for every series.
+
+        auto lease = ConnectionPool::instance().acquire();
+        curl_easy_setopt(lease.get(), CURLOPT_URL, url.c_str());
+
+    */
+    class ConnectionPool
+    {
+    public:
+        class Lease
+        {
+        public:
+            Lease(ConnectionPool *pool, CURL *handle) : pool_(pool), handle_(handle) {}
+
+            Lease(const Lease &) = delete;
+            Lease &operator=(const Lease &) = delete;
+
+            Lease(Lease &&other) noexcept : pool_(other.pool_), handle_(other.handle_)
+            {
+                other.handle_ = nullptr;
+            }
+
+            ~Lease()
+            {
+                if (handle_)
+                    pool_->release(handle_);
+            }
+
+            CURL *get() const
+            {
+                return handle_;
+            }
+
+        private:
+            ConnectionPool *pool_;
+            CURL *handle_;
+        };
+
+        static ConnectionPool &instance()
+        {
+            static ConnectionPool pool;
+            return pool;
+        }
+
+        ~ConnectionPool()
+        {
+            for (auto *handle : idle_)
+                curl_easy_cleanup(handle);
+        }
+
+        void set_capacity(size_t capacity)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            capacity_ = capacity > 0 ? capacity : 1;
+
+            while (idle_.size() > capacity_)
+            {
+                curl_easy_cleanup(idle_.back());
+                idle_.pop_back();
+                --created_;
+            }
+            cv_.notify_all();
+        }
+
+        size_t capacity() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return capacity_;
+        }
+
+        // blocks while every handle is leased out
+        Lease acquire()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]
+                     { return !idle_.empty() || created_ < capacity_; });
+
+            CURL *handle = nullptr;
+            if (!idle_.empty())
+            {
+                handle = idle_.back();
+                idle_.pop_back();
+            }
+            else
+            {
+                handle = curl_easy_init();
+                if (!handle)
+                    throw std::runtime_error("curl_easy_init() failed.");
+                ++created_;
+            }
+            lock.unlock();
+
+            prepare(handle);
+            return Lease(this, handle);
+        }
+
+    private:
+        ConnectionPool()
+        {
+            CurlGlobal::ensure();
+            CurlShare::instance(); // outlives the pool, handles are cleaned up first
+        }
+
+        mutable std::mutex mutex_;
+        std::condition_variable cv_;
+        std::vector<CURL *> idle_;
+        size_t capacity_ = 4;
+        size_t created_ = 0;
+
+        // curl_easy_reset drops the options of the previous transfer (the share
+        // included) but keeps live connections.
+        static void prepare(CURL *handle)
+        {
+            curl_easy_reset(handle);
+            CurlShare::instance().attach(handle);
+            curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+            curl_easy_setopt(handle, CURLOPT_TCP_KEEPIDLE, 60L);
+            curl_easy_setopt(handle, CURLOPT_TCP_KEEPINTVL, 30L);
+            curl_easy_setopt(handle, CURLOPT_SSL_SESSIONID_CACHE, 1L);
+        }
+
+        void release(CURL *handle)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (created_ <= capacity_)
+            {
+                idle_.push_back(handle);
+            }
+            else
+            {
+                curl_easy_cleanup(handle);
+                --created_;
+            }
+            cv_.notify_one();
+        }
+    };
+
+}
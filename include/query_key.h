@@ -0,0 +1,141 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "date_range.h"
+#include "murmur_hash.h"
+#include "types.h"
+
+namespace evds
+{
+
+    // .................................................................. normalize_date
+    // "1-1-2020" -> "01-01-2020", anything that is not a dd-mm-yyyy date as it is
+    std::string normalize_date(const std::string &str)
+    {
+        auto date = parse_date(str);
+        return date ? format_date(*date) : str;
+    }
+
+    // .................................................................. canonical_query
+    /*
+    What an EVDS request URL asks for, written one way only:
+
+        .../series=B-A&startDate=1-1-2020&endDate=31-12-2020&aggregationTypes=avg-sum&formulas=0-1&type=json
+        .../endDate=31-12-2020&series=A:sum:1,B:avg:0&startDate=01-01-2020&type=json
+
+    Codes are sorted and deduplicated together with their per-series
+    aggregation and formula, dates are normalized, the other parameters
+    are sorted by name. The part before the query (host and path) stays.
+    No credentials go in: the API key travels in a header.
+
+    with_dates = false leaves startDate and endDate out: the series set a
+    range of dates is asked for (range cache).
+    */
+    std::string canonical_query(const std::string &url, bool with_dates = true)
+    {
+        auto slash = url.rfind('/');
+        std::string prefix = slash == std::string::npos ? "" : url.substr(0, slash + 1);
+        std::string query = slash == std::string::npos ? url : url.substr(slash + 1);
+
+        std::map<std::string, std::string> params;
+        for (const auto &part : splitString(query, '&'))
+        {
+            auto eq = part.find('=');
+            if (eq == std::string::npos)
+                params[part] = "";
+            else
+                params[part.substr(0, eq)] = part.substr(eq + 1);
+        }
+
+        for (const char *name : {"startDate", "endDate"})
+        {
+            auto it = params.find(name);
+            if (it == params.end())
+                continue;
+            if (with_dates)
+                it->second = normalize_date(it->second);
+            else
+                params.erase(it);
+        }
+
+        auto series = params.find("series");
+        if (series != params.end())
+        {
+            auto codes = splitString(series->second, '-');
+
+            // per series lists follow the order of the codes, they are sorted with them
+            auto per_series = [&](const char *name) -> std::vector<std::string>
+            {
+                auto it = params.find(name);
+                if (it == params.end())
+                    return std::vector<std::string>(codes.size());
+
+                auto values = splitString(it->second, '-');
+                if (values.size() != codes.size())
+                    return std::vector<std::string>(codes.size());
+
+                params.erase(it);
+                return values;
+            };
+            auto aggregations = per_series("aggregationTypes");
+            auto formulas = per_series("formulas");
+
+            std::vector<std::tuple<std::string, std::string, std::string>> items;
+            for (size_t i = 0; i < codes.size(); ++i)
+                items.emplace_back(codes[i], aggregations[i], formulas[i]);
+            std::sort(items.begin(), items.end());
+            items.erase(std::unique(items.begin(), items.end()), items.end());
+
+            std::vector<std::string> parts;
+            for (const auto &[code, aggregation, formula] : items)
+                parts.push_back(code + ":" + aggregation + ":" + formula);
+            series->second = join(parts, ",");
+        }
+
+        std::vector<std::string> parts;
+        for (const auto &[name, value] : params)
+            parts.push_back(name + "=" + value);
+        return prefix + join(parts, "&");
+    }
+
+    // .................................................................. query_key
+    // stable 128-bit name of the query, the same on every machine and build
+    std::string query_key(const std::string &url)
+    {
+        return murmur3_128(canonical_query(url)).hex();
+    }
+
+}
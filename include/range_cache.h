@@ -0,0 +1,314 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "batch.h"
+#include "cache.h"
+#include "dataframe.h"
+#include "date_range.h"
+#include "frame_codec.h"
+#include "freshness.h"
+#include "query_key.h"
+
+namespace evds
+{
+
+    // .................................................................. cacheable_range
+    /*
+    Window of config the range cache may serve, nullopt when it may not:
+    dates that are not dd-mm-yyyy, or rows that are not day_separable,
+    where a slice of a longer window need not be what EVDS returns for the
+    shorter one.
+    */
+    std::optional<DateRange> cacheable_range(const Config &config)
+    {
+        if (!day_separable(config.frequency, config.formulas))
+            return std::nullopt;
+
+        auto start = parse_date(config.start_date);
+        auto end = parse_date(config.end_date);
+        if (!start || !end || *end < *start)
+            return std::nullopt;
+
+        return DateRange{*start, *end};
+    }
+
+    // .................................................................. RangeLookup
+    /*
+    How a wanted window relates to the cached intervals of its series set
+    (sorted, disjoint):
+
+    covering : the interval holding all of wanted, if one does
+    touching : intervals overlapping wanted or adjacent to it, they are
+               merged with the new rows into one interval afterwards
+    missing  : parts of wanted no interval covers, to be fetched
+    */
+    struct RangeLookup
+    {
+        std::optional<DateRange> covering;
+        std::vector<DateRange> touching;
+        std::vector<DateRange> missing;
+    };
+
+    RangeLookup lookup_range(const std::vector<DateRange> &intervals, const DateRange &wanted)
+    {
+        RangeLookup lookup;
+        Days cursor = wanted.start;
+
+        for (const auto &interval : intervals)
+        {
+            if (interval.end + std::chrono::days(1) < wanted.start || interval.start > wanted.end + std::chrono::days(1))
+                continue;
+
+            lookup.touching.push_back(interval);
+            if (interval.start <= wanted.start && interval.end >= wanted.end)
+                lookup.covering = interval;
+
+            if (interval.start > cursor && cursor <= wanted.end)
+                lookup.missing.push_back(DateRange{cursor, std::min(wanted.end, interval.start - std::chrono::days(1))});
+            cursor = std::max(cursor, interval.end + std::chrono::days(1));
+        }
+
+        if (cursor <= wanted.end)
+            lookup.missing.push_back(DateRange{cursor, wanted.end});
+        return lookup;
+    }
+
+    // .................................................................. column_series
+    /*
+    Series codes of the columns of a datagroup response: every column
+    but date_col, named back from '_' to '.'. Columns with a formula
+    suffix ("TP_DK_USD_A-1") are left out.
+    */
+    std::map<std::string, std::string> column_series(const DataFrame &df, const std::string &date_col = "Tarih")
+    {
+        std::map<std::string, std::string> codes; // code -> column
+        for (const auto &[name, _] : df.columns)
+        {
+            if (name == date_col || name.find('-') != std::string::npos)
+                continue;
+
+            std::string code = name;
+            std::replace(code.begin(), code.end(), '_', '.');
+            codes[code] = name;
+        }
+        return codes;
+    }
+
+    // .................................................................. RangeStore
+    /*
+    The range cache: for every series set (canonical query without the
+    dates) the intervals whose rows are stored, each as one encoded frame.
+    A set is one series code, or one datagroup.
+
+        "range_index" <set>                  "01-01-2000 31-12-2025\n..."
+        "range_frame" <set>|<start>|<end>    encode_frame of the rows
+
+    Intervals never reach past yesterday: later rows may still be
+    published, a window ending today or in the future is fetched again
+    from yesterday on. Each frame keeps the EntryMeta of its oldest rows,
+    its last observation is the end of the interval.
+    */
+    class RangeStore
+    {
+    public:
+        static std::string set_key(const std::string &url)
+        {
+            return canonical_query(url, false);
+        }
+
+        // the set of one series code (or datagroup) under config
+        static std::string set_key(const std::string &index, const Config &config)
+        {
+            return set_key(UrlBuilder(Index(index), config).get_url());
+        }
+
+        static std::vector<DateRange> intervals(const std::string &set)
+        {
+            std::string body;
+            std::vector<DateRange> result;
+            if (!Cache::instance().check_and_load_cache(index_fnc, body, set))
+                return result;
+
+            std::istringstream lines(body);
+            std::string start, end;
+            while (lines >> start >> end)
+            {
+                auto s = parse_date(start);
+                auto e = parse_date(end);
+                if (s && e && *s <= *e)
+                    result.push_back(DateRange{*s, *e});
+            }
+            std::sort(result.begin(), result.end(), [](const DateRange &a, const DateRange &b)
+                      { return a.start < b.start; });
+            return result;
+        }
+
+        static std::optional<DataFrame> load(const std::string &set, const DateRange &interval)
+        {
+            std::string body;
+            if (!Cache::instance().check_and_load_cache(frame_fnc, body, frame_key(set, interval)))
+                return std::nullopt;
+
+            try
+            {
+                return decode_frame(body);
+            }
+            catch (const std::exception &ex)
+            {
+                std::cerr << "[range cache] " << ex.what() << std::endl;
+                return std::nullopt;
+            }
+        }
+
+        static std::optional<EntryMeta> meta(const std::string &set, const DateRange &interval)
+        {
+            return Cache::instance().load_cache_meta(frame_fnc, frame_key(set, interval));
+        }
+
+        /*
+        Stores the rows of df as one interval, clipped to yesterday, in
+        place of the intervals in `replaced` (the touching ones it was
+        merged from).
+        */
+        static void replace(const std::string &set, const std::vector<DateRange> &replaced, DateRange interval, const DataFrame &df, EntryMeta meta)
+        {
+            std::lock_guard<std::mutex> lock(set_mutex(set));
+            replace_locked(set, replaced, interval, df, meta);
+        }
+
+        /*
+        merge() for rows that can be sliced by date later, other rows
+        (not all dd-mm-yyyy) are not stored. The intervals df replaces are
+        read again under the lock of the set, another fetch may have stored
+        some since the caller looked them up.
+        */
+        static void record(const std::string &set, const DateRange &interval, const DataFrame &df, const EntryMeta &meta)
+        {
+            if (sliceable(df))
+                merge(set, interval, df, meta);
+        }
+
+        /*
+        Stores fetched, the rows of `interval`, together with the stored
+        intervals it overlaps or touches. Intervals inside `interval` are
+        superseded, the others are merged in and pass on their age. The
+        whole read-merge-write holds the lock of the set, so two merges of
+        one set never drop each other's intervals.
+        */
+        static void merge(const std::string &set, const DateRange &interval, const DataFrame &fetched, EntryMeta meta)
+        {
+            std::lock_guard<std::mutex> lock(set_mutex(set));
+            auto lookup = lookup_range(intervals(set), interval);
+
+            DateRange hull = interval;
+            std::vector<DataFrame> parts = {fetched}; // first, stitch_frames keeps the first row of a date
+            for (const auto &stored : lookup.touching)
+            {
+                if (stored.start >= interval.start && stored.end <= interval.end)
+                    continue;
+
+                auto df = load(set, stored);
+                if (!df)
+                    continue;
+
+                parts.push_back(std::move(*df));
+                hull.start = std::min(hull.start, stored.start);
+                hull.end = std::max(hull.end, stored.end);
+
+                auto stored_meta = RangeStore::meta(set, stored);
+                meta.fetched_at = std::min(meta.fetched_at, stored_meta ? stored_meta->fetched_at : 0);
+            }
+
+            const DataFrame &merged = parts.size() == 1 ? fetched : stitch_frames(parts);
+            if (sliceable(merged))
+                replace_locked(set, lookup.touching, hull, merged, meta);
+        }
+
+    private:
+        static constexpr const char *index_fnc = "range_index";
+        static constexpr const char *frame_fnc = "range_frame";
+        static constexpr size_t lock_stripes = 64;
+
+        static std::string frame_key(const std::string &set, const DateRange &interval)
+        {
+            return set + "|" + format_date(interval.start) + "|" + format_date(interval.end);
+        }
+
+        // guards the interval list of a set, sets share one of lock_stripes mutexes
+        static std::mutex &set_mutex(const std::string &set)
+        {
+            static std::array<std::mutex, lock_stripes> stripes;
+            return stripes[std::hash<std::string>{}(set) % lock_stripes];
+        }
+
+        static bool sliceable(const DataFrame &df)
+        {
+            return df.rows() == 0 || last_observation(df).has_value();
+        }
+
+        // set_mutex(set) held
+        static void replace_locked(const std::string &set, const std::vector<DateRange> &replaced, DateRange interval, const DataFrame &df, EntryMeta meta)
+        {
+            interval.end = std::min(interval.end, today() - std::chrono::days(1));
+            meta.last_observation = static_cast<int32_t>(interval.end.time_since_epoch().count());
+
+            std::vector<DateRange> kept;
+            for (const auto &old : intervals(set))
+            {
+                if (std::find_if(replaced.begin(), replaced.end(), [&old](const DateRange &r)
+                                 { return r.start == old.start && r.end == old.end; }) == replaced.end())
+                    kept.push_back(old);
+                else if (old.start != interval.start || old.end != interval.end)
+                    Cache::instance().erase_cache(frame_fnc, frame_key(set, old));
+            }
+
+            if (interval.start <= interval.end)
+            {
+                Cache::instance().save_cache_meta(meta, frame_fnc, encode_frame(rows_between(df, interval.start, interval.end)), frame_key(set, interval));
+                kept.push_back(interval);
+            }
+
+            std::ostringstream body;
+            for (const auto &range : kept)
+                body << format_date(range.start) << " " << format_date(range.end) << "\n";
+            Cache::instance().save_cache(index_fnc, body.str(), set);
+        }
+    };
+
+}
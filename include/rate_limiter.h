@@ -0,0 +1,293 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Sermet Pekin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#include "types.h"
+
+namespace evds
+{
+
+    // .................................................................. Outcome
+    enum class Outcome
+    {
+        ok,
+        throttled,    // 429, 503
+        server_error, // other 5xx
+        timeout,
+        failed,   // client side / network errors, do not affect the limits
+        cancelled // given up by the caller, only frees the slot
+    };
+
+    Outcome classify_outcome(bool transport_ok, bool timed_out, long status)
+    {
+        if (timed_out)
+            return Outcome::timeout;
+        if (!transport_ok)
+            return Outcome::failed;
+        if (status == 429 || status == 503)
+            return Outcome::throttled;
+        if (status >= 500)
+            return Outcome::server_error;
+        return Outcome::ok;
+    }
+
+    // .................................................................. RateMetrics
+    struct RateMetrics
+    {
+        double rate = 0;          // tokens per second currently allowed
+        double observed_rate = 0; // requests started per second, last 5 seconds
+        size_t in_flight = 0;
+        size_t limit = 0; // current concurrency limit
+        size_t succeeded = 0;
+        size_t throttled = 0;
+        size_t errors = 0;
+
+        std::string str() const
+        {
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(1)
+                << "[rate] allowed: " << rate << "/s observed: " << observed_rate << "/s"
+                << " in flight: " << in_flight << "/" << limit
+                << " ok: " << succeeded << " throttled: " << throttled << " errors: " << errors;
+            return oss.str();
+        }
+    };
+
+    // .................................................................. max_jobs
+    // concurrency ceiling per API key: --jobs unless --max_jobs allows more
+    inline size_t max_jobs(const Config &config)
+    {
+        return std::max<size_t>(std::max(config.jobs, config.max_jobs), 1);
+    }
+
+    // .................................................................. RateLimiter
+    /*
+    Token bucket in front of every EVDS request plus AIMD concurrency, one
+    per API key (see KeyPool).
+
+    A request needs a token (refilled at `rate` per second, up to `burst`)
+    and a free slot below the concurrency limit. Healthy responses grow the
+    limit by one per window of `limit` responses, up to max_jobs(), and let
+    the rate recover towards rate_limit. 429/5xx or timeouts halve both,
+    at most once per second so one burst of failures counts once.
+    */
+    class RateLimiter
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        RateLimiter() = default;
+        RateLimiter(const RateLimiter &) = delete;
+        RateLimiter &operator=(const RateLimiter &) = delete;
+
+        // applied when the settings differ from the current ones
+        void configure(const Config &config)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            if (config.rate_limit == max_rate_ && config.burst == burst_ &&
+                std::max<size_t>(config.jobs, 1) == initial_limit_ && max_jobs(config) == max_limit_ &&
+                config.healthy_latency_ms == healthy_latency_ms_)
+                return;
+
+            max_rate_ = config.rate_limit;
+            burst_ = std::max(config.burst, 1.0);
+            initial_limit_ = std::max<size_t>(config.jobs, 1);
+            max_limit_ = max_jobs(config);
+            healthy_latency_ms_ = config.healthy_latency_ms;
+
+            rate_ = max_rate_;
+            tokens_ = burst_;
+            limit_ = static_cast<double>(initial_limit_);
+        }
+
+        // non blocking, for the FetchLoop
+        bool try_acquire()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return take();
+        }
+
+        // how long until try_acquire may succeed again
+        std::chrono::milliseconds wait_hint()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return wait_hint_locked();
+        }
+
+        void release(Outcome outcome, double latency_ms)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (in_flight_ > 0)
+                --in_flight_;
+
+            switch (outcome)
+            {
+            case Outcome::ok:
+                ++succeeded_;
+                if (latency_ms <= healthy_latency_ms_)
+                    increase();
+                break;
+            case Outcome::throttled:
+                ++throttled_;
+                decrease();
+                break;
+            case Outcome::server_error:
+            case Outcome::timeout:
+                ++errors_;
+                decrease();
+                break;
+            case Outcome::failed:
+                ++errors_;
+                break;
+            case Outcome::cancelled:
+                break;
+            }
+        }
+
+        RateMetrics metrics()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            refill();
+            forget_old_starts();
+
+            RateMetrics m;
+            m.rate = unlimited() ? 0 : rate_;
+            m.observed_rate = starts_.size() / window_seconds;
+            m.in_flight = in_flight_;
+            m.limit = static_cast<size_t>(limit_);
+            m.succeeded = succeeded_;
+            m.throttled = throttled_;
+            m.errors = errors_;
+            return m;
+        }
+
+    private:
+        static constexpr double window_seconds = 5.0;
+
+        std::mutex mutex_;
+
+        // settings
+        double max_rate_ = 0; // 0 : no rate limit
+        double burst_ = 1;
+        size_t initial_limit_ = 4;
+        size_t max_limit_ = 4;
+        double healthy_latency_ms_ = 0;
+
+        // state
+        double rate_ = 0;
+        double tokens_ = 1;
+        double limit_ = 4;
+        size_t in_flight_ = 0;
+        Clock::time_point last_refill_ = Clock::now();
+        Clock::time_point last_decrease_{};
+        std::deque<Clock::time_point> starts_;
+
+        size_t succeeded_ = 0;
+        size_t throttled_ = 0;
+        size_t errors_ = 0;
+
+        bool unlimited() const
+        {
+            return max_rate_ <= 0;
+        }
+
+        void refill()
+        {
+            auto now = Clock::now();
+            double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+            last_refill_ = now;
+            tokens_ = std::min(burst_, tokens_ + elapsed * rate_);
+        }
+
+        void forget_old_starts()
+        {
+            auto horizon = Clock::now() - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(window_seconds));
+            while (!starts_.empty() && starts_.front() < horizon)
+                starts_.pop_front();
+        }
+
+        bool take()
+        {
+            if (in_flight_ >= static_cast<size_t>(limit_))
+                return false;
+
+            if (!unlimited())
+            {
+                refill();
+                if (tokens_ < 1.0)
+                    return false;
+                tokens_ -= 1.0;
+            }
+
+            ++in_flight_;
+            starts_.push_back(Clock::now());
+            forget_old_starts();
+            return true;
+        }
+
+        std::chrono::milliseconds wait_hint_locked()
+        {
+            if (unlimited() || in_flight_ >= static_cast<size_t>(limit_))
+                return std::chrono::milliseconds(1000); // woken up by release()
+
+            refill();
+            double missing = std::max(0.0, 1.0 - tokens_);
+            return std::chrono::milliseconds(static_cast<long>(std::ceil(missing / rate_ * 1000.0)) + 1);
+        }
+
+        void increase()
+        {
+            limit_ = std::min(static_cast<double>(max_limit_), limit_ + 1.0 / limit_);
+            if (!unlimited())
+                rate_ = std::min(max_rate_, rate_ + max_rate_ / 20.0);
+        }
+
+        void decrease()
+        {
+            auto now = Clock::now();
+            if (now - last_decrease_ < std::chrono::seconds(1))
+                return;
+            last_decrease_ = now;
+
+            limit_ = std::max(1.0, limit_ / 2.0);
+            if (!unlimited())
+                rate_ = std::max(max_rate_ / 16.0, rate_ / 2.0);
+        }
+    };
+
+}
@@ -0,0 +1,225 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Sermet Pekin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <curl/curl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace evds
+{
+
+    // .................................................................. TransferError
+    /*
+    A transfer that did not produce a body. code is the curl result,
+    status the HTTP status when the server answered (0 otherwise).
+    */
+    class TransferError : public std::runtime_error
+    {
+    public:
+        TransferError(const std::string &message, CURLcode code, long status)
+            : std::runtime_error(message), code_(code), status_(status)
+        {
+        }
+
+        CURLcode code() const
+        {
+            return code_;
+        }
+
+        long status() const
+        {
+            return status_;
+        }
+
+        // worth another attempt: network hiccups, timeouts, 408/429/5xx
+        bool transient() const
+        {
+            switch (code_)
+            {
+            case CURLE_COULDNT_RESOLVE_HOST:
+            case CURLE_COULDNT_CONNECT:
+            case CURLE_OPERATION_TIMEDOUT:
+            case CURLE_SSL_CONNECT_ERROR:
+            case CURLE_SEND_ERROR:
+            case CURLE_RECV_ERROR:
+            case CURLE_GOT_NOTHING:
+            case CURLE_PARTIAL_FILE:
+            case CURLE_HTTP2:
+            case CURLE_HTTP2_STREAM:
+                return true;
+            case CURLE_HTTP_RETURNED_ERROR:
+                return status_ == 408 || status_ == 429 || status_ >= 500;
+            default:
+                return false;
+            }
+        }
+
+    private:
+        CURLcode code_;
+        long status_;
+    };
+
+    // .................................................................. DeadlineExceeded
+    // a request given up because its deadline (Config::deadline, deadline_ms) passed
+    class DeadlineExceeded : public std::runtime_error
+    {
+    public:
+        explicit DeadlineExceeded(const std::string &url)
+            : std::runtime_error("deadline exceeded: " + url)
+        {
+        }
+    };
+
+    using Deadline = std::chrono::steady_clock::time_point;
+
+    // the earlier of the run's deadline and deadline_ms from now
+    Deadline request_deadline(const Config &config)
+    {
+        Deadline deadline = config.deadline;
+        if (config.deadline_ms > 0)
+        {
+            auto own = std::chrono::steady_clock::now() +
+                       std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(config.deadline_ms));
+            deadline = std::min(deadline, own);
+        }
+        return deadline;
+    }
+
+    bool expired(Deadline deadline)
+    {
+        return std::chrono::steady_clock::now() >= deadline;
+    }
+
+    // CURLOPT_TIMEOUT_MS for an attempt starting now : timeout_ms, cut to what is left
+    long attempt_timeout_ms(long timeout_ms, Deadline deadline)
+    {
+        if (deadline == Deadline::max())
+            return timeout_ms;
+
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        left = std::max<long long>(left, 1);
+        return timeout_ms > 0 ? static_cast<long>(std::min<long long>(timeout_ms, left)) : static_cast<long>(left);
+    }
+
+    // .................................................................. RetryPolicy
+    /*
+    Exponential backoff with full jitter: the n-th retry waits a random
+    time in [0, min(max_ms, base_ms * 2^(n-1))], so clients that failed
+    together do not come back together.
+    */
+    struct RetryPolicy
+    {
+        int retries = 3;
+        double base_ms = 250;
+        double max_ms = 8000;
+
+        explicit RetryPolicy(const Config &config)
+            : retries(std::max(config.retries, 0)), base_ms(config.retry_base_ms), max_ms(config.retry_max_ms)
+        {
+        }
+
+        // failures : attempts that failed so far
+        bool allows(int failures) const
+        {
+            return failures <= retries;
+        }
+
+        std::chrono::milliseconds delay(int failures) const
+        {
+            static thread_local std::mt19937 rng{std::random_device{}()};
+
+            double cap = std::min(max_ms, base_ms * std::pow(2.0, std::max(failures - 1, 0)));
+            std::uniform_real_distribution<double> jitter(0.0, std::max(cap, 0.0));
+            return std::chrono::milliseconds(static_cast<long>(jitter(rng)));
+        }
+    };
+
+    // .................................................................. LatencyTracker
+    /*
+    Latencies of the last successful transfers, used to decide when a
+    request is slow enough to be worth a hedged duplicate.
+    */
+    class LatencyTracker
+    {
+    public:
+        static LatencyTracker &instance()
+        {
+            static LatencyTracker tracker;
+            return tracker;
+        }
+
+        void record(double latency_ms)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            samples_.push_back(latency_ms);
+            if (samples_.size() > window)
+                samples_.pop_front();
+        }
+
+        // nullopt until enough samples were seen
+        std::optional<double> percentile(double p)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (samples_.size() < min_samples)
+                return std::nullopt;
+
+            std::vector<double> sorted(samples_.begin(), samples_.end());
+            size_t rank = std::min(sorted.size() - 1, static_cast<size_t>(std::ceil(p * sorted.size())) - 1);
+            std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+            return sorted[rank];
+        }
+
+        void clear()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            samples_.clear();
+        }
+
+    private:
+        LatencyTracker() = default;
+
+        static constexpr size_t window = 200;
+        static constexpr size_t min_samples = 20;
+
+        std::mutex mutex_;
+        std::deque<double> samples_;
+    };
+
+}
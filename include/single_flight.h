@@ -0,0 +1,113 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ *
+ * MIT License
+ *
+ * Copyright (c) 2024 Sermet Pekin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace evds
+{
+
+    // .................................................................. SingleFlight
+    /*
+    Table of requests currently in flight, keyed by the canonical request.
+
+    The first caller for a key becomes the leader: join() returns true and
+    the leader must call complete() once its fetch finished. Callers that
+    join while the fetch is running only get their callback queued, and
+    complete() hands the same result to all of them.
+
+        if (SingleFlight<DataFrame>::instance().join(key, done))
+            fetch(..., [key](auto error, DataFrame df)
+                  { SingleFlight<DataFrame>::instance().complete(key, error, std::move(df)); });
+    */
+    template <typename T>
+    class SingleFlight
+    {
+    public:
+        using Callback = std::function<void(std::exception_ptr, T)>;
+
+        static SingleFlight &instance()
+        {
+            static SingleFlight flights;
+            return flights;
+        }
+
+        // true : the caller leads the fetch for key
+        bool join(const std::string &key, Callback done)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto [it, leader] = flights_.try_emplace(key);
+            it->second.push_back(std::move(done));
+            if (!leader)
+                ++shared_;
+            return leader;
+        }
+
+        void complete(const std::string &key, std::exception_ptr error, T value)
+        {
+            std::vector<Callback> waiters;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = flights_.find(key);
+                if (it == flights_.end())
+                    return;
+                waiters = std::move(it->second);
+                flights_.erase(it);
+            }
+
+            // every waiter but the last gets a copy
+            for (size_t i = 0; i < waiters.size(); ++i)
+            {
+                if (i + 1 < waiters.size())
+                    waiters[i](error, value);
+                else
+                    waiters[i](error, std::move(value));
+            }
+        }
+
+        // callers that were served by someone else's fetch
+        size_t shared() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return shared_;
+        }
+
+    private:
+        SingleFlight() = default;
+
+        mutable std::mutex mutex_;
+        std::unordered_map<std::string, std::vector<Callback>> flights_;
+        size_t shared_ = 0;
+    };
+
+}
@@ -35,6 +35,7 @@
 #include <vector>
 #include <regex>
 #include <iterator>
+#include <chrono>
 
 #pragma once
 
@@ -116,8 +117,49 @@ namespace evds
         std::string formulas = "default";    // | level | percentage_change | difference |  year_to_year_percent_change | year_to_year_differences |
         std::string aggregation = "default"; //  | avg      |min    | max    | first    | last    |    sum
         bool cache = true;
+        bool stale_while_revalidate = true; // serve stale cache entries at once, refresh them in the background
+        // set on background refreshes: cache lookups are skipped, results are still saved
+        bool refresh = false;
+        double cache_max_mb = 0; // byte budget of .caches, least recently used entries are evicted, 0 : none
 
         bool auto_confirm = true;
+
+        size_t pool_size = 4; // idle curl handles kept between requests (ConnectionPool and FetchLoop)
+        size_t jobs = 4;      // transfers in flight at once on the FetchLoop (starting point)
+        size_t max_jobs = 0;  // per API key, the RateLimiter may raise concurrency up to this, 0 : stay at jobs
+
+        double rate_limit = 20;           // requests per second, 0 : no limit
+        double burst = 10;                // requests that may start at once
+        double healthy_latency_ms = 5000; // slower responses do not raise concurrency
+
+        bool stream = true; // parse items while the body is downloading
+
+        bool split = true;              // fetch long date windows as concurrent chunks
+        double chunk_target_ms = 2000; // chunk length adapts towards this latency
+
+        bool batch = true;            // merge index groups into multi-series requests
+        size_t max_url_length = 2000; // upper bound for a merged request URL
+
+        int retries = 3;                 // extra attempts after a transient failure
+        double retry_base_ms = 250;      // first backoff, doubles per retry (with jitter)
+        double retry_max_ms = 8000;      // backoff cap
+        long timeout_ms = 120000;        // per attempt, 0 : no limit
+        long connect_timeout_ms = 10000; // per attempt
+        bool hedge = false;              // duplicate requests slower than the p95 latency
+        std::string priority = "normal"; // FetchLoop queue: interactive | normal | bulk
+
+        std::string transport = "curl";       // curl | record | replay
+        std::string fixture_dir = "fixtures"; // where record writes and replay reads responses
+        double replay_latency_ms = 0;         // simulated latency of a replayed response
+
+        bool incremental = false; // with cache: stored ranges never go stale, only newer observations are requested
+        bool warm_up = true;      // connect to EVDS while the requests are being planned
+
+        double budget_ms = 0;   // time budget of a whole run (main), 0 : none
+        double deadline_ms = 0; // per request, retries included, 0 : none
+        // absolute deadline, main() sets it from budget_ms. Requests still
+        // running or queued at that point fail with DeadlineExceeded.
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
     };
 
 }
\ No newline at end of file
@@ -26,6 +26,7 @@
  */
 
 #include "get_series.h"
+#include "batch.h"
 #include "dotenv_.h"
 #include "shorten.h"
 
@@ -43,6 +44,7 @@
 #include <algorithm>
 #include <utility>
 #include <functional>
+#include <future>
 #include "../extern/nlohmann/json.hpp"
 
 int main(int argc, char *argv[])
@@ -65,7 +67,11 @@ int main(int argc, char *argv[])
     auto args = parseArgs(poptions);
     config.indexes = poptions.indexes;
 
-    setConfigOptions(args, config);
+    if (!setConfigOptions(args, config))
+    {
+        show_usage();
+        return EXIT_FAILURE;
+    }
 
     if (poptions.indexes.empty())
     {
@@ -76,24 +82,137 @@ int main(int argc, char *argv[])
         return EXIT_SUCCESS;
     }
 
-    DataFrame df_current;
+    // every request of the run has to finish within budget_ms
+    if (config.budget_ms > 0)
+        config.deadline = std::chrono::steady_clock::now() +
+                          std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(config.budget_ms));
+
+    // least recently used entries make room for new ones
+    if (config.cache)
+        Cache::instance().pack().set_budget(static_cast<uint64_t>(config.cache_max_mb * 1048576));
+
+    warm_up(config);
+
+    // compatible index groups are merged into multi-series requests
+    std::vector<evds::SeriesQuery> queries;
+    for (const auto &CurrentIndex : poptions.indexes)
+        queries.push_back({CurrentIndex, config});
+
+    std::vector<evds::Batch> batches;
+    if (config.batch)
+        batches = evds::plan_batches(queries, config.max_url_length);
+    else
+        for (size_t i = 0; i < queries.size(); ++i)
+            batches.push_back(evds::Batch{queries[i].index, {i}, config});
+
+    // every batch is queued on the FetchLoop first, at most
+    // config.jobs of them are in flight. CSVs are written in index order.
+    auto submit = [](const std::string &index, const evds::Config &batch_config)
+    {
+        try
+        {
+            return get_series_async(index, batch_config).share();
+        }
+        catch (...)
+        {
+            std::promise<DataFrame> failed;
+            failed.set_exception(std::current_exception());
+            return failed.get_future().share();
+        }
+    };
+
+    std::vector<std::shared_future<DataFrame>> frames;
+    std::vector<size_t> batch_of(queries.size());
+    frames.reserve(batches.size());
 
-    for (auto &CurrentIndex : poptions.indexes)
+    for (size_t b = 0; b < batches.size(); ++b)
     {
+        for (size_t member : batches[b].members)
+            batch_of[member] = b;
+
+        frames.push_back(submit(batches[b].index, batches[b].config));
+    }
+
+    // one bad code fails the whole merged request: every group of it is
+    // then queued alone, all at once, the first time one of them is written
+    std::vector<std::shared_future<DataFrame>> fallbacks(queries.size());
+    auto fall_back = [&](size_t b)
+    {
+        for (size_t member : batches[b].members)
+            if (!fallbacks[member].valid())
+                fallbacks[member] = submit(queries[member].index, batches[b].config);
+    };
+
+    size_t written = 0;
+    std::vector<std::string> cancelled;
+    std::vector<std::string> failed;
+
+    for (size_t i = 0; i < poptions.indexes.size(); ++i)
+    {
+        auto &CurrentIndex = poptions.indexes[i];
+        const auto &batch = batches[batch_of[i]];
 
         try
         {
-            auto df = get_series(CurrentIndex, config);
+            DataFrame df;
+            if (batch.members.size() == 1)
+            {
+                df = frames[batch_of[i]].get();
+            }
+            else
+            {
+                try
+                {
+                    df = evds::split_frame(frames[batch_of[i]].get(), evds::series_codes(CurrentIndex), evds::series_codes(batch.index));
+                }
+                catch (const evds::DeadlineExceeded &)
+                {
+                    throw;
+                }
+                catch (const std::exception &ex)
+                {
+                    std::cerr << "[batch failed] " << ex.what() << " retrying " << CurrentIndex << std::endl;
+                    fall_back(batch_of[i]);
+                    df = fallbacks[i].get();
+                }
+            }
 
-            df_current = df;
             std::string f_name = getShortFilename(CurrentIndex);
             df.to_csv("data_" + f_name + ".csv", ',');
+            ++written;
+        }
+        catch (const evds::DeadlineExceeded &ex)
+        {
+            std::cerr << "passing: " << CurrentIndex << " : " << ex.what() << std::endl;
+            cancelled.push_back(CurrentIndex);
         }
         catch (const std::exception &ex)
         {
-            std::cerr << "passing: " << CurrentIndex << ex.what() << std::endl;
+            std::cerr << "passing: " << CurrentIndex << " : " << ex.what() << std::endl;
+            failed.push_back(CurrentIndex + " : " + ex.what());
         }
     }
 
+    // stale cache entries served above are still being refreshed
+    evds::Revalidator::instance().wait();
+
+    std::cout << "[summary] written: " << written << " failed: " << failed.size()
+              << " cancelled by deadline: " << cancelled.size() << std::endl;
+    for (const auto &item : failed)
+        std::cout << "  failed    " << item << std::endl;
+    for (const auto &item : cancelled)
+        std::cout << "  cancelled " << item << std::endl;
+
+    std::cout << evds::KeyPool::instance().metrics_str() << std::endl;
+    std::cout << evds::ConnectionStats::instance().str() << std::endl;
+    std::cout << evds::FetchLoop::instance().queue_stats().str() << std::endl;
+    if (config.cache)
+    {
+        std::cout << Cache::instance().pack().stats().str() << std::endl;
+        std::cout << evds::Revalidator::instance().str() << std::endl;
+    }
+    if (size_t shared = evds::SingleFlight<DataFrame>::instance().shared())
+        std::cout << "[single-flight] requests served by an identical one in flight: " << shared << std::endl;
+
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,188 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "../include/batch.h"
+#include <iostream>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+void test_plan_batches_merges()
+{
+    evds::Config config;
+    std::vector<evds::SeriesQuery> queries = {
+        {"TP.DK.USD.A", config},
+        {"bie_yssk", config},
+        {"TP.DK.EUR.A-TP.DK.USD.A", config},
+    };
+
+    auto batches = evds::plan_batches(queries, 2000);
+
+    assert(batches.size() == 2);
+    assert(batches[0].index == "TP.DK.USD.A-TP.DK.EUR.A");
+    assert((batches[0].members == std::vector<size_t>{0, 2}));
+    assert(batches[1].index == "bie_yssk");
+
+    std::cout << "test_plan_batches_merges passed!" << std::endl;
+}
+
+void test_plan_batches_limits()
+{
+    evds::Config config;
+    evds::Config other = config;
+    other.frequency = "monthly";
+
+    std::vector<evds::SeriesQuery> queries = {
+        {"TP.DK.USD.A", config},
+        {"TP.DK.EUR.A", other},
+        {"TP.DK.GBP.A", config},
+    };
+
+    // different frequency never shares a URL
+    auto batches = evds::plan_batches(queries, 2000);
+    assert(batches.size() == 2);
+    assert((batches[0].members == std::vector<size_t>{0, 2}));
+
+    // a URL limit too small for two codes keeps every query alone
+    auto single = evds::UrlBuilder(evds::Index("TP.DK.USD.A"), config).build().size();
+    batches = evds::plan_batches(queries, single + 5);
+    assert(batches.size() == 3);
+
+    std::cout << "test_plan_batches_limits passed!" << std::endl;
+}
+
+void test_split_frame()
+{
+    evds::DataFrame df;
+    df.add_value("Tarih", std::string("01-01-2020"));
+    df.add_value("TP_DK_USD_A", 5.9);
+    df.add_value("TP_DK_EUR_A-1", 6.5);
+    df.add_value("TP_DK_GBP_A", 7.5);
+
+    auto part = evds::split_frame(df, {"TP.DK.EUR.A", "TP.DK.GBP.A"}, {"TP.DK.USD.A", "TP.DK.EUR.A", "TP.DK.GBP.A"});
+
+    assert(part.columns.size() == 3);
+    assert(part.columns.count("Tarih"));
+    assert(part.columns.count("TP_DK_EUR_A-1"));
+    assert(part.columns.count("TP_DK_GBP_A"));
+
+    std::cout << "test_split_frame passed!" << std::endl;
+}
+
+void test_different_date_sets()
+{
+    // a daily and a monthly series: the merged response has the union of their dates
+    evds::DataFrame df;
+    df.add_value("Tarih", std::string("01-01-2020"));
+    df.add_value("TP_DK_USD_A", 5.9);
+    df.add_value("TP_FG_J0", 100.0);
+    df.add_value("Tarih", std::string("02-01-2020"));
+    df.add_value("TP_DK_USD_A", 6.0);
+    df.add_value("TP_FG_J0", std::monostate{});
+
+    // a part keeps every row of the response, empty ones included
+    std::vector<std::string> codes = {"TP.DK.USD.A", "TP.FG.J0"};
+    auto monthly = evds::split_frame(df, {"TP.FG.J0"}, codes);
+    assert(monthly.rows() == 2);
+    assert(monthly.columns.count("TP_DK_USD_A") == 0);
+
+    // native frequencies are unknown at the default frequency: other families stay apart
+    evds::Config config;
+    std::vector<evds::SeriesQuery> queries = {
+        {"TP.DK.USD.A", config},
+        {"TP.FG.J0", config},
+        {"TP.DK.EUR.A", config},
+    };
+    auto batches = evds::plan_batches(queries, 2000);
+    assert(batches.size() == 2);
+    assert(batches[0].index == "TP.DK.USD.A-TP.DK.EUR.A");
+    assert(batches[1].index == "TP.FG.J0");
+
+    // with a frequency EVDS converts every series to it
+    for (auto &query : queries)
+        query.config.frequency = "monthly";
+    assert(evds::plan_batches(queries, 2000).size() == 1);
+
+    std::cout << "test_different_date_sets passed!" << std::endl;
+}
+
+std::string read_file(const std::string &path)
+{
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+void test_null_rows_match_unbatched()
+{
+    // two daily series over a holiday: EVDS sends the empty row in both responses
+    std::vector<std::string> dates = {"31-12-2019", "01-01-2020", "02-01-2020"};
+    std::vector<evds::Cell> usd = {5.9, std::monostate{}, 6.0};
+    std::vector<evds::Cell> eur = {6.6, std::monostate{}, 6.7};
+
+    evds::DataFrame alone;
+    evds::DataFrame merged;
+    for (size_t i = 0; i < dates.size(); ++i)
+    {
+        alone.add_value("Tarih", dates[i]);
+        alone.add_value("TP_DK_USD_A", usd[i]);
+        merged.add_value("Tarih", dates[i]);
+        merged.add_value("TP_DK_USD_A", usd[i]);
+        merged.add_value("TP_DK_EUR_A", eur[i]);
+    }
+
+    auto part = evds::split_frame(merged, {"TP.DK.USD.A"}, {"TP.DK.USD.A", "TP.DK.EUR.A"});
+    assert(part.rows() == 3);
+
+    auto dir = std::filesystem::temp_directory_path();
+    auto unbatched = (dir / "evds_test_unbatched.csv").string();
+    auto batched = (dir / "evds_test_batched.csv").string();
+    alone.to_csv(unbatched, ',');
+    part.to_csv(batched, ',');
+    assert(read_file(batched) == read_file(unbatched));
+
+    std::filesystem::remove(unbatched);
+    std::filesystem::remove(batched);
+
+    std::cout << "test_null_rows_match_unbatched passed!" << std::endl;
+}
+
+int main()
+{
+    test_plan_batches_merges();
+    test_plan_batches_limits();
+    test_split_frame();
+    test_different_date_sets();
+    test_null_rows_match_unbatched();
+
+    std::cout << "All tests passed!" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,377 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "../include/cache.h"
+#include <iostream>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+static std::string fresh_dir(const std::string &name)
+{
+    auto dir = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir);
+    return dir.string();
+}
+
+void test_save_and_load()
+{
+    std::string dir = fresh_dir("evds_test_cache_load");
+    Cache cache(dir, false);
+
+    std::string result;
+    assert(!cache.check_and_load_cache("f", result, "a"));
+
+    cache.save_cache("f", "first", "a");
+    cache.save_cache("f", "other", "b");
+    cache.save_cache("f", "second", "a");
+
+    assert(cache.check_and_load_cache("f", result, "a") && result == "second");
+    assert(cache.check_and_load_cache("f", result, "b") && result == "other");
+    assert(cache.pack().size() == 2);
+    assert(std::filesystem::exists(dir + "/cache.pack"));
+
+    std::cout << "test_save_and_load passed!" << std::endl;
+}
+
+void test_reopen()
+{
+    std::string dir = fresh_dir("evds_test_cache_reopen");
+    {
+        PackFile pack(dir);
+        pack.save("k1", "v1");
+        pack.save("k2", "v2");
+    } // writes cache.idx
+
+    {
+        PackFile pack(dir);
+        std::string data;
+        assert(pack.load("k1", data) && data == "v1");
+        pack.save("k3", "v3"); // after the snapshot, found by the tail scan
+        pack.save("k1", "v1 again");
+    }
+
+    // a torn record at the end is dropped
+    {
+        std::ofstream out(dir + "/cache.pack", std::ios::binary | std::ios::app);
+        out << "EVPK garbage";
+    }
+    std::filesystem::remove(dir + "/cache.idx");
+
+    PackFile pack(dir);
+    std::string data;
+    assert(pack.size() == 3);
+    assert(pack.load("k1", data) && data == "v1 again");
+    assert(pack.load("k3", data) && data == "v3");
+    assert(pack.dead_bytes() > 0);
+
+    std::cout << "test_reopen passed!" << std::endl;
+}
+
+void test_compact()
+{
+    std::string dir = fresh_dir("evds_test_cache_compact");
+    PackFile pack(dir);
+    for (int i = 0; i < 10; ++i)
+        pack.save("key", std::string(100, 'a' + i));
+    pack.save("other", "x");
+
+    auto before = std::filesystem::file_size(pack.pack_path());
+    pack.compact();
+    auto after = std::filesystem::file_size(pack.pack_path());
+
+    std::string data;
+    assert(after < before);
+    assert(pack.dead_bytes() == 0);
+    assert(pack.load("key", data) && data == std::string(100, 'j'));
+    assert(pack.load("other", data) && data == "x");
+
+    pack.save("new", "y");
+    assert(pack.load("new", data) && data == "y");
+
+    std::cout << "test_compact passed!" << std::endl;
+}
+
+void test_compact_while_saving()
+{
+    std::string dir = fresh_dir("evds_test_cache_compact_busy");
+    PackFile pack(dir);
+    pack.set_codec(PackFile::Codec::none);
+
+    // saves, overwrites and erases go on while the pack is rewritten
+    std::thread writer([&pack]
+                       {
+        for (int i = 0; i < 2000; ++i)
+        {
+            pack.save("k" + std::to_string(i % 20), std::to_string(i) + std::string(2000, 'x'));
+            if (i % 100 == 99)
+                pack.erase("k" + std::to_string(i % 20));
+        } });
+    for (int i = 0; i < 20; ++i)
+        pack.compact();
+    writer.join();
+    pack.compact();
+
+    auto check = [](PackFile &p)
+    {
+        std::string data;
+        for (int k = 0; k < 20; ++k)
+        {
+            int last = 1980 + k;
+            bool erased = last % 100 == 99;
+            assert(p.load("k" + std::to_string(k), data) != erased);
+            assert(erased || data == std::to_string(last) + std::string(2000, 'x'));
+        }
+    };
+    check(pack);
+    assert(pack.dead_bytes() == 0);
+
+    PackFile reopened(dir);
+    check(reopened);
+
+    std::cout << "test_compact_while_saving passed!" << std::endl;
+}
+
+void test_background_compaction()
+{
+    std::string dir = fresh_dir("evds_test_cache_compact_background");
+    std::string data;
+    {
+        PackFile pack(dir);
+        pack.set_codec(PackFile::Codec::none);
+        pack.set_budget(64 * 1024);
+
+        // overwrites fill the pack with dead records, saves start compactions and go on meanwhile
+        for (int i = 0; i < 3000; ++i)
+            pack.save("k" + std::to_string(i % 10), std::to_string(i) + std::string(1000, 'x'));
+        pack.wait_for_compaction();
+
+        for (int k = 0; k < 10; ++k)
+            assert(pack.load("k" + std::to_string(k), data) && data == std::to_string(2990 + k) + std::string(1000, 'x'));
+        assert(std::filesystem::file_size(pack.pack_path()) < 3000 * 1000);
+    }
+
+    PackFile reopened(dir);
+    assert(reopened.size() == 10);
+    assert(reopened.load("k9", data) && data == "2999" + std::string(1000, 'x'));
+
+    std::cout << "test_background_compaction passed!" << std::endl;
+}
+
+void test_compression()
+{
+    std::string dir = fresh_dir("evds_test_cache_zlib");
+    std::string body;
+    for (int i = 0; i < 2000; ++i)
+        body += "{\"Tarih\":\"01-01-2024\",\"TP_DK_USD_A\":\"29.5\"},";
+
+    PackFile pack(dir);
+    pack.save("big", body);
+    pack.save("small", "tiny");
+
+    auto stats = pack.stats();
+    assert(stats.entries == 2);
+    assert(stats.raw_bytes == body.size() + 4);
+    assert(stats.ratio() > 5);
+
+    std::string data;
+    assert(pack.load("big", data) && data == body);
+    assert(pack.load("small", data) && data == "tiny");
+
+    // inflated in pieces, the sink runs without the pack lock
+    std::string streamed;
+    size_t pieces = 0;
+    size_t entries = 0;
+    assert(pack.load_stream("big", [&](const char *p, size_t n)
+                            { streamed.append(p, n); ++pieces; entries = pack.size(); }));
+    assert(streamed == body && pieces > 1 && entries == 2);
+
+    // records of any codec keep loading
+    pack.set_codec(PackFile::Codec::none);
+    pack.save("plain", body);
+    assert(pack.load("plain", data) && data == body);
+    assert(pack.load("big", data) && data == body);
+    assert(pack.stats().hits == 5);
+
+    std::cout << "test_compression passed!" << std::endl;
+}
+
+void test_entry_meta()
+{
+    std::string dir = fresh_dir("evds_test_cache_meta");
+    EntryMeta meta;
+    meta.fetched_at = 1700000000;
+    meta.last_observation = 19000;
+    meta.frequency = 5;
+    {
+        PackFile pack(dir);
+        pack.save("k", "v", meta);
+        pack.save("other", "v");
+        pack.save("other", "v2");
+        assert(!pack.meta("missing"));
+    }
+
+    PackFile pack(dir);
+    auto loaded = pack.meta("k");
+    assert(loaded && loaded->fetched_at == 1700000000 && loaded->last_observation == 19000 && loaded->frequency == 5);
+    assert(pack.meta("other")->fetched_at > 0);
+    assert(pack.meta("other")->last_observation == EntryMeta::unknown_day);
+
+    pack.compact();
+    assert(pack.meta("k")->frequency == 5);
+
+    std::string data;
+    assert(pack.load("k", data) && data == "v");
+
+    std::cout << "test_entry_meta passed!" << std::endl;
+}
+
+void test_eviction()
+{
+    std::string dir = fresh_dir("evds_test_cache_lru");
+    std::string value(1000, 'x');
+    std::string data;
+    {
+        PackFile pack(dir);
+        pack.set_codec(PackFile::Codec::none);
+        for (int i = 0; i < 5; ++i)
+            pack.save("k" + std::to_string(i), value);
+        uint64_t entry_bytes = pack.stats().stored_bytes / 5;
+
+        // k0 is used again, k1 is the least recently used one now
+        assert(pack.load("k0", data));
+        pack.set_budget(entry_bytes * 5);
+        pack.save("k5", value);
+
+        assert(pack.size() == 5);
+        assert(!pack.load("k1", data));
+        assert(pack.load("k0", data));
+        assert(pack.stats().evicted == 1);
+
+        // a lower budget is reached over the next saves, evict_batch entries each
+        pack.set_budget(entry_bytes * 2);
+        pack.save("k6", value);
+        assert(pack.size() == 2);
+        assert(pack.load("k6", data) && pack.load("k0", data));
+        assert(pack.stats().stored_bytes <= entry_bytes * 2);
+    }
+
+    // evictions and access order survive a restart
+    PackFile pack(dir);
+    assert(pack.size() == 2);
+    assert(!pack.load("k5", data));
+    pack.set_codec(PackFile::Codec::none);
+    pack.set_budget(pack.stats().stored_bytes);
+    pack.save("k7", value);
+    assert(!pack.load("k6", data));
+    assert(pack.load("k0", data) && pack.load("k7", data));
+
+    std::cout << "test_eviction passed!" << std::endl;
+}
+
+void test_stamps_survive_crash()
+{
+    std::string dir = fresh_dir("evds_test_cache_crash");
+    std::string value(1000, 'x');
+    std::string data;
+
+    // never destroyed: only what save() flushed is on disk
+    auto *crashed = new PackFile(dir);
+    crashed->set_codec(PackFile::Codec::none);
+    crashed->save("k0", value);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    crashed->save("k1", value);
+    assert(crashed->load("k0", data)); // k1 is the least recently used one now
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    crashed->save("k2", value);
+
+    PackFile pack(dir);
+    pack.set_codec(PackFile::Codec::none);
+    pack.set_budget(pack.stats().stored_bytes);
+    pack.save("k3", value);
+    assert(!pack.load("k1", data));
+    assert(pack.load("k0", data) && pack.load("k2", data));
+
+    std::cout << "test_stamps_survive_crash passed!" << std::endl;
+}
+
+void test_damaged_index()
+{
+    std::string dir = fresh_dir("evds_test_cache_index");
+    {
+        PackFile pack(dir);
+        pack.save("k1", "v1");
+        pack.save("k2", "v2");
+    }
+
+    // count of the index header: magic, entry_size, hash_check and covered come first
+    for (uint64_t count : {uint64_t(1) << 62, uint64_t(3)})
+    {
+        {
+            std::fstream index(dir + "/cache.idx", std::ios::in | std::ios::out | std::ios::binary);
+            index.seekp(24);
+            index.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        }
+
+        PackFile pack(dir);
+        std::string data;
+        assert(pack.size() == 2);
+        assert(pack.load("k1", data) && data == "v1");
+        assert(pack.load("k2", data) && data == "v2");
+    }
+
+    // entries of the old layout are removed
+    std::ofstream(dir + "/12345.cache") << "old";
+    {
+        PackFile pack(dir);
+        assert(pack.size() == 2);
+    }
+    assert(!std::filesystem::exists(dir + "/12345.cache"));
+    assert(std::filesystem::exists(dir + "/cache.pack"));
+
+    std::cout << "test_damaged_index passed!" << std::endl;
+}
+
+int main()
+{
+    test_save_and_load();
+    test_reopen();
+    test_compact();
+    test_compact_while_saving();
+    test_background_compaction();
+    test_compression();
+    test_entry_meta();
+    test_eviction();
+    test_stamps_survive_crash();
+    test_damaged_index();
+
+    std::cout << "All tests passed!" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,217 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "../include/date_range.h"
+#include <iostream>
+#include <cassert>
+
+void test_parse_format_date()
+{
+    auto d = evds::parse_date("29-02-2020");
+    assert(d.has_value());
+    assert(evds::format_date(*d) == "29-02-2020");
+
+    assert(!evds::parse_date("31-02-2020").has_value());
+    assert(!evds::parse_date("2020-02-01x").has_value());
+
+    std::cout << "test_parse_format_date passed!" << std::endl;
+}
+
+void test_planner_covers_range()
+{
+    auto plan = evds::plan_range("01-01-2000", "31-12-2010", "daily", "default");
+    assert(plan.has_value());
+
+    evds::RangePlanner planner(plan->planned, plan->final_end, 730, 1000);
+
+    auto expected = plan->planned.start;
+    while (!planner.done())
+    {
+        auto range = planner.next();
+        assert(range.start == expected);
+        assert(range.end >= range.start);
+        expected = range.end + std::chrono::days(1);
+
+        // fast chunks grow the next one, slow chunks shrink it
+        int before = planner.span_days();
+        planner.observe(range, 100);
+        assert(planner.span_days() >= before || planner.span_days() == 730 * 8);
+    }
+    assert(evds::format_date(expected - std::chrono::days(1)) == "31-12-2010");
+
+    assert(!evds::plan_range("01-01-2020", "31-12-2020", "daily", "default").has_value());
+    assert(!evds::plan_range("01-01-1950", "31-12-2020", "annual", "default").has_value());
+
+    std::cout << "test_planner_covers_range passed!" << std::endl;
+}
+
+void test_chunks_match_whole()
+{
+    // period rows and lagged formulas would differ at the cuts, they go as one request
+    assert(!evds::plan_range("01-01-2000", "31-12-2010", "monthly", "default").has_value());
+    assert(!evds::plan_range("01-01-2000", "31-12-2010", "weekly", "level").has_value());
+    assert(!evds::plan_range("01-01-2000", "31-12-2010", "daily", "pc").has_value());
+    assert(!evds::plan_range("01-01-2000", "31-12-2010", "default", "mov_ave").has_value());
+    assert(evds::plan_range("01-01-2000", "31-12-2010", "business", "level").has_value());
+
+    // day separable rows: the stitched chunks are the whole window
+    auto plan = evds::plan_range("01-01-2000", "31-12-2010", "default", "default");
+    assert(plan.has_value());
+
+    evds::DataFrame whole;
+    double value = 0;
+    for (auto day = plan->planned.start; day <= plan->planned.end; day += std::chrono::days(1))
+    {
+        whole.add_value("Tarih", evds::format_date(day));
+        whole.add_value("A", value++);
+    }
+
+    evds::RangePlanner planner(plan->planned, plan->final_end, evds::chunk_days("default"), 1000);
+    std::vector<evds::DataFrame> parts;
+    while (!planner.done())
+    {
+        auto range = planner.next();
+        parts.push_back(evds::rows_between(whole, range.start, range.end));
+        planner.observe(range, 3000);
+    }
+    assert(parts.size() > 1);
+
+    auto stitched = evds::stitch_frames(parts);
+    assert(stitched.rows() == whole.rows());
+    assert(stitched.columns["Tarih"] == whole.columns["Tarih"]);
+    assert(stitched.columns["A"] == whole.columns["A"]);
+
+    std::cout << "test_chunks_match_whole passed!" << std::endl;
+}
+
+void test_daily_rows()
+{
+    auto frame = [](const std::vector<std::string> &dates)
+    {
+        evds::DataFrame df;
+        for (const auto &date : dates)
+            df.add_value("Tarih", date);
+        return df;
+    };
+
+    // business days with a weekend and a holiday week
+    assert(evds::daily_rows(frame({"02-01-2020", "03-01-2020", "06-01-2020", "07-01-2020", "15-01-2020", "16-01-2020"})));
+    assert(!evds::daily_rows(frame({"01-01-2020", "01-02-2020", "01-03-2020"})));
+    assert(!evds::daily_rows(frame({"06-01-2020", "13-01-2020", "20-01-2020"})));
+    assert(!evds::daily_rows(frame({"2019", "2020"})));
+    assert(!evds::daily_rows(frame({"02-01-2020"})));
+
+    std::cout << "test_daily_rows passed!" << std::endl;
+}
+
+void test_stitch_frames()
+{
+    evds::DataFrame first;
+    first.add_value("Tarih", std::string("01-01-2020"));
+    first.add_value("A", 1.0);
+    first.add_value("Tarih", std::string("02-01-2020"));
+    first.add_value("A", 2.0);
+
+    evds::DataFrame second;
+    second.add_value("Tarih", std::string("02-01-2020"));
+    second.add_value("A", 2.0);
+    second.add_value("Tarih", std::string("01-02-2019"));
+    second.add_value("A", 0.5);
+
+    auto df = evds::stitch_frames({first, second});
+
+    assert(df.rows() == 3);
+    assert(std::get<std::string>(df.columns["Tarih"][0]) == "01-02-2019");
+    assert(std::get<std::string>(df.columns["Tarih"][2]) == "02-01-2020");
+    assert(std::get<double>(df.columns["A"][0]) == 0.5);
+
+    std::cout << "test_stitch_frames passed!" << std::endl;
+}
+
+void test_join_frames()
+{
+    evds::DataFrame usd;
+    usd.add_value("Tarih", std::string("02-01-2020"));
+    usd.add_value("TP_DK_USD_A", 5.9);
+    usd.add_value("Tarih", std::string("03-01-2020"));
+    usd.add_value("TP_DK_USD_A", 6.0);
+
+    evds::DataFrame eur;
+    eur.add_value("Tarih", std::string("01-01-2020"));
+    eur.add_value("TP_DK_EUR_A", 6.6);
+    eur.add_value("Tarih", std::string("02-01-2020"));
+    eur.add_value("TP_DK_EUR_A", 6.7);
+
+    auto df = evds::join_frames({usd, eur});
+
+    assert(df.rows() == 3);
+    assert(std::get<std::string>(df.columns["Tarih"][0]) == "01-01-2020");
+    assert(std::holds_alternative<std::monostate>(df.columns["TP_DK_USD_A"][0]));
+    assert(std::get<double>(df.columns["TP_DK_USD_A"][1]) == 5.9);
+    assert(std::get<double>(df.columns["TP_DK_EUR_A"][1]) == 6.7);
+    assert(std::holds_alternative<std::monostate>(df.columns["TP_DK_EUR_A"][2]));
+    assert(df.get_column_type("TP_DK_EUR_A") == typeid(double));
+
+    std::cout << "test_join_frames passed!" << std::endl;
+}
+
+void test_last_observation()
+{
+    evds::DataFrame df;
+    df.add_value("Tarih", std::string("31-12-2019"));
+    df.add_value("Tarih", std::string("02-01-2020"));
+    df.add_value("Tarih", std::string("01-01-2020"));
+
+    auto last = evds::last_observation(df);
+    assert(last && evds::format_date(*last) == "02-01-2020");
+
+    auto within = evds::rows_between(df, *evds::parse_date("01-01-2020"), *evds::parse_date("01-01-2020"));
+    assert(within.rows() == 1);
+    assert(std::get<std::string>(within.columns["Tarih"][0]) == "01-01-2020");
+
+    evds::DataFrame quarterly;
+    quarterly.add_value("Tarih", std::string("2020-Q1"));
+    assert(!evds::last_observation(quarterly));
+
+    std::cout << "test_last_observation passed!" << std::endl;
+}
+
+int main()
+{
+    test_parse_format_date();
+    test_planner_covers_range();
+    test_chunks_match_whole();
+    test_daily_rows();
+    test_stitch_frames();
+    test_join_frames();
+    test_last_observation();
+
+    std::cout << "All tests passed!" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,305 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "../include/fetch_loop.h"
+#include <iostream>
+#include <cassert>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+void test_priority_class()
+{
+    assert(evds::priority_class("interactive") == evds::Priority::interactive);
+    assert(evds::priority_class("bulk") == evds::Priority::bulk);
+
+    bool thrown = false;
+    try
+    {
+        evds::priority_class("urgent");
+    }
+    catch (const std::runtime_error &)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+
+    std::cout << "test_priority_class passed!" << std::endl;
+}
+
+void test_queue_stats()
+{
+    evds::QueueStats stats;
+    assert(stats.str() == "[queue] no transfers");
+
+    stats.record(evds::Priority::bulk, 10);
+    stats.record(evds::Priority::bulk, 30);
+    assert(stats.str() == "[queue] bulk: 2 avg wait: 20.0 ms max: 30.0 ms");
+
+    std::cout << "test_queue_stats passed!" << std::endl;
+}
+
+void test_interactive_passes_bulk()
+{
+    evds::Config config;
+    config.rate_limit = 0;
+    config.jobs = 1;
+    config.max_jobs = 1;
+    evds::KeyPool::instance().configure(config, {"key"});
+
+    auto &loop = evds::FetchLoop::instance();
+    loop.set_max_in_flight(1);
+
+    std::mutex mutex;
+    std::vector<std::string> order;
+    std::promise<void> started;
+    std::promise<void> all_done;
+    size_t left = 5;
+
+    // unsupported scheme: the transfer fails right away without network
+    auto job = [&](const std::string &name, evds::Priority priority, bool slow)
+    {
+        evds::FetchJob job;
+        job.priority = priority;
+        job.setup = [&, name, slow](CURL *curl, const std::string &)
+        {
+            curl_easy_setopt(curl, CURLOPT_URL, "nothing://evds");
+            if (slow)
+            {
+                started.set_value();
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        };
+        job.done = [&, name](CURL *, CURLcode)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(name);
+            if (--left == 0)
+                all_done.set_value();
+        };
+        return job;
+    };
+
+    // the first job keeps the only slot while the others are queued
+    loop.submit(job("first", evds::Priority::normal, true));
+    started.get_future().wait();
+    loop.submit(job("bulk1", evds::Priority::bulk, false));
+    loop.submit(job("bulk2", evds::Priority::bulk, false));
+    loop.submit(job("bulk3", evds::Priority::bulk, false));
+    loop.submit(job("lookup", evds::Priority::interactive, false));
+    all_done.get_future().wait();
+
+    assert((order == std::vector<std::string>{"first", "lookup", "bulk1", "bulk2", "bulk3"}));
+
+    auto stats = loop.queue_stats();
+    assert(stats.started[static_cast<size_t>(evds::Priority::bulk)] == 3);
+    assert(stats.started[static_cast<size_t>(evds::Priority::interactive)] == 1);
+
+    std::cout << "test_interactive_passes_bulk passed!" << std::endl;
+}
+
+void test_setup_errors()
+{
+    auto &loop = evds::FetchLoop::instance();
+
+    // setup throws: the job fails with the exception and the loop goes on
+    std::promise<std::string> failed;
+    evds::FetchJob job;
+    job.setup = [](CURL *, const std::string &)
+    {
+        throw std::runtime_error("bad request");
+    };
+    job.done = [](CURL *, CURLcode)
+    {
+        assert(false);
+    };
+    job.failed = [&](std::exception_ptr error)
+    {
+        try
+        {
+            std::rethrow_exception(error);
+        }
+        catch (const std::runtime_error &ex)
+        {
+            failed.set_value(ex.what());
+        }
+    };
+    loop.submit(std::move(job));
+    assert(failed.get_future().get() == "bad request");
+
+    // without failed, done gets CURLE_FAILED_INIT; a non-standard throw is contained
+    std::promise<CURLcode> code;
+    evds::FetchJob plain;
+    plain.setup = [](CURL *, const std::string &)
+    {
+        throw 42;
+    };
+    plain.done = [&](CURL *curl, CURLcode res)
+    {
+        assert(curl == nullptr);
+        code.set_value(res);
+        throw 43;
+    };
+    loop.submit(std::move(plain));
+    assert(code.get_future().get() == CURLE_FAILED_INIT);
+
+    // the loop still runs transfers afterwards
+    std::promise<CURLcode> next;
+    evds::FetchJob after;
+    after.setup = [](CURL *curl, const std::string &)
+    {
+        curl_easy_setopt(curl, CURLOPT_URL, "nothing://evds");
+    };
+    after.done = [&](CURL *, CURLcode res)
+    {
+        next.set_value(res);
+    };
+    loop.submit(std::move(after));
+    assert(next.get_future().get() == CURLE_UNSUPPORTED_PROTOCOL);
+
+    std::cout << "test_setup_errors passed!" << std::endl;
+}
+
+// answers `requests` keep-alive requests on 127.0.0.1, one connection at a time
+class LocalServer
+{
+public:
+    explicit LocalServer(int requests)
+    {
+        fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        bind(fd_, reinterpret_cast<sockaddr *>(&addr), len);
+        listen(fd_, 4);
+        getsockname(fd_, reinterpret_cast<sockaddr *>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+
+        thread_ = std::thread([this, requests]
+                              {
+            int served = 0;
+            while (served < requests)
+            {
+                int client = accept(fd_, nullptr, nullptr);
+                if (client < 0)
+                    return;
+                std::string pending;
+                char buffer[4096];
+                while (served < requests)
+                {
+                    auto end = pending.find("\r\n\r\n");
+                    if (end == std::string::npos)
+                    {
+                        ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+                        if (n <= 0)
+                            break;
+                        pending.append(buffer, n);
+                        continue;
+                    }
+                    pending.erase(0, end + 4);
+                    std::string reply = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+                    send(client, reply.data(), reply.size(), 0);
+                    ++served;
+                }
+                close(client);
+            } });
+    }
+
+    ~LocalServer()
+    {
+        shutdown(fd_, SHUT_RDWR);
+        close(fd_);
+        thread_.join();
+    }
+
+    std::string url() const
+    {
+        return "http://127.0.0.1:" + std::to_string(port_) + "/";
+    }
+
+private:
+    int fd_ = -1;
+    int port_ = 0;
+    std::thread thread_;
+};
+
+static size_t discard(char *, size_t size, size_t nmemb, void *)
+{
+    return size * nmemb;
+}
+
+void test_connection_reuse()
+{
+    LocalServer server(2);
+    auto &loop = evds::FetchLoop::instance();
+    auto &stats = evds::ConnectionStats::instance();
+    size_t transfers = stats.transfers();
+    size_t reused = stats.reused();
+
+    // the second transfer finds the first one's connection in the loop's cache
+    for (int i = 0; i < 2; ++i)
+    {
+        std::promise<CURLcode> done;
+        evds::FetchJob job;
+        job.setup = [&](CURL *curl, const std::string &)
+        {
+            curl_easy_setopt(curl, CURLOPT_URL, server.url().c_str());
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard);
+        };
+        job.done = [&](CURL *, CURLcode res)
+        {
+            done.set_value(res);
+        };
+        loop.submit(std::move(job));
+        assert(done.get_future().get() == CURLE_OK);
+    }
+
+    assert(stats.transfers() == transfers + 2);
+    assert(stats.reused() == reused + 1);
+
+    std::cout << "test_connection_reuse passed!" << std::endl;
+}
+
+int main()
+{
+    test_priority_class();
+    test_queue_stats();
+    test_interactive_passes_bulk();
+    test_setup_errors();
+    test_connection_reuse();
+
+    std::cout << "All tests passed!" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,63 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "../include/fixtures.h"
+#include <iostream>
+#include <cassert>
+
+void test_fixture_round_trip()
+{
+    auto dir = (std::filesystem::temp_directory_path() / "evdscpp_test_fixtures").string();
+    std::filesystem::remove_all(dir);
+
+    evds::FixtureStore store(dir);
+    std::string url = "https://evds2.tcmb.gov.tr/service/evds/series=TP.DK.USD.A&type=json";
+
+    assert(!store.load(url));
+
+    store.save(url, "{\"items\":[]}");
+    assert(store.load(url) == std::string("{\"items\":[]}"));
+    assert(!store.load(url + "&frequency=5"));
+
+    std::ifstream index(dir + "/index.txt");
+    std::string line;
+    std::getline(index, line);
+    assert(line == evds::FixtureStore::file_name(url) + " " + url);
+
+    std::filesystem::remove_all(dir);
+
+    std::cout << "test_fixture_round_trip passed!" << std::endl;
+}
+
+int main()
+{
+    test_fixture_round_trip();
+
+    std::cout << "All tests passed!" << std::endl;
+
+    return 0;
+}
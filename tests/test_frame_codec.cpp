@@ -0,0 +1,162 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "../include/frame_codec.h"
+#include <iostream>
+#include <cassert>
+
+void test_round_trip()
+{
+    evds::DataFrame df;
+    df.add_value("Tarih", std::string("01-01-2024"));
+    df.add_value("Tarih", std::string("02-01-2024"));
+    df.add_value("TP_DK_USD_A", 29.5);
+    df.add_value("TP_DK_USD_A", std::monostate{});
+    df.add_value("UNIXTIME", 1704067200LL);
+    df.add_value("UNIXTIME", 1704153600LL);
+    df.add_value("MIXED", 1.5);
+    df.add_value("MIXED", std::string("n/a"));
+
+    auto decoded = evds::decode_frame(evds::encode_frame(df));
+
+    assert(decoded.columns == df.columns);
+    assert(decoded.column_types == df.column_types);
+    assert(std::get<std::string>(decoded.columns["Tarih"][1]) == "02-01-2024");
+    assert(std::holds_alternative<std::monostate>(decoded.columns["TP_DK_USD_A"][1]));
+    assert(std::get<long long>(decoded.columns["UNIXTIME"][0]) == 1704067200LL);
+
+    std::cout << "test_round_trip passed!" << std::endl;
+}
+
+void test_empty_frame()
+{
+    evds::DataFrame df;
+    auto decoded = evds::decode_frame(evds::encode_frame(df));
+    assert(decoded.columns.empty());
+
+    std::cout << "test_empty_frame passed!" << std::endl;
+}
+
+void test_rejects_bad_data()
+{
+    evds::DataFrame df;
+    df.add_value("A", 1.0);
+    std::string encoded = evds::encode_frame(df);
+
+    assert(evds::is_encoded_frame(encoded));
+    assert(!evds::is_encoded_frame("{\"items\": []}"));
+
+    for (const std::string &bad : {std::string("{\"items\": []}"), encoded.substr(0, encoded.size() - 3), encoded + "x"})
+    {
+        bool thrown = false;
+        try
+        {
+            evds::decode_frame(bad);
+        }
+        catch (const std::runtime_error &)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    std::cout << "test_rejects_bad_data passed!" << std::endl;
+}
+
+bool rejected(const std::string &data)
+{
+    try
+    {
+        evds::decode_frame(data);
+    }
+    catch (const std::runtime_error &)
+    {
+        return true;
+    }
+    return false;
+}
+
+// header of a one-column frame with the given row count and layout, no values
+std::string column_header(uint32_t columns, uint64_t rows, uint8_t layout)
+{
+    std::string out("EVDF", 4);
+    evds::frame_codec::put<uint8_t>(out, evds::frame_codec::version);
+    evds::frame_codec::put<uint32_t>(out, columns);
+    evds::frame_codec::put<uint32_t>(out, 1);
+    out += "A";
+    evds::frame_codec::put<uint8_t>(out, evds::frame_codec::no_type);
+    evds::frame_codec::put<uint64_t>(out, rows);
+    evds::frame_codec::put<uint8_t>(out, layout);
+    return out;
+}
+
+void test_rejects_garbage_counts()
+{
+    // counts from a corrupt file fail before anything is reserved
+    assert(rejected(column_header(1, UINT64_MAX, evds::frame_codec::none)));
+    assert(rejected(column_header(1, UINT64_MAX, evds::frame_codec::number)));
+    assert(rejected(column_header(1, UINT64_MAX, evds::frame_codec::mixed)));
+    assert(rejected(column_header(1, 1ULL << 40, evds::frame_codec::none)));
+    assert(rejected(column_header(UINT32_MAX, 0, evds::frame_codec::none)));
+
+    // a few missing cells still decode
+    auto empty = evds::decode_frame(column_header(1, 3, evds::frame_codec::none));
+    assert(empty.columns["A"].size() == 3);
+
+    // every truncation of a real frame
+    evds::DataFrame df;
+    df.add_value("Tarih", std::string("01-01-2020"));
+    df.add_value("A", 1.5);
+    df.add_value("B", std::monostate{});
+    df.add_value("Tarih", std::string("02-01-2020"));
+    df.add_value("A", std::monostate{});
+    df.add_value("B", std::monostate{});
+    std::string encoded = evds::encode_frame(df);
+    for (size_t size = 0; size < encoded.size(); ++size)
+        assert(rejected(encoded.substr(0, size)));
+
+    // garbage behind the magic
+    std::string garbage = encoded.substr(0, 5);
+    for (int i = 0; i < 64; ++i)
+        garbage += static_cast<char>(0xFF - i);
+    assert(rejected(garbage));
+
+    std::cout << "test_rejects_garbage_counts passed!" << std::endl;
+}
+
+int main()
+{
+    test_round_trip();
+    test_empty_frame();
+    test_rejects_bad_data();
+    test_rejects_garbage_counts();
+
+    std::cout << "All tests passed!" << std::endl;
+
+    return 0;
+}
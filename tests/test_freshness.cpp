@@ -0,0 +1,110 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "../include/freshness.h"
+#include <iostream>
+#include <cassert>
+
+using namespace evds;
+
+static EntryMeta fetched(int64_t seconds_ago, const std::string &frequency)
+{
+    Config config;
+    config.frequency = frequency;
+    EntryMeta meta = entry_meta(config);
+    meta.fetched_at -= seconds_ago;
+    return meta;
+}
+
+void test_ttl_by_frequency()
+{
+    assert(frequency_code("monthly") == 5);
+    assert(frequency_code("annually") == frequency_code("annual"));
+    assert(frequency_code("default") == 0);
+
+    const int64_t hour = 3600, day = 86400;
+    assert(!is_stale(fetched(hour, "daily")));
+    assert(is_stale(fetched(day + hour, "daily")));
+    assert(is_stale(fetched(day + hour, "default")));
+    assert(!is_stale(fetched(6 * day, "weekly")));
+    assert(is_stale(fetched(8 * day, "weekly")));
+    assert(!is_stale(fetched(20 * day, "monthly")));
+    assert(!is_stale(fetched(200 * day, "annual")));
+    assert(is_stale(fetched(400 * day, "annual")));
+
+    std::cout << "test_ttl_by_frequency passed!" << std::endl;
+}
+
+void test_historic_data()
+{
+    const int64_t day = 86400;
+    EntryMeta meta = fetched(10 * day, "daily");
+
+    // the data ended the day before the fetch
+    meta.last_observation = static_cast<int32_t>(meta.fetched_at / day - 1);
+    assert(is_stale(meta));
+
+    // a closed window, only revisions can change it
+    meta.last_observation = static_cast<int32_t>(meta.fetched_at / day - 365);
+    assert(!is_stale(meta));
+    assert(is_stale(meta, meta.fetched_at + 31 * day));
+
+    // written before entries had metadata
+    assert(is_stale(EntryMeta()));
+
+    std::cout << "test_historic_data passed!" << std::endl;
+}
+
+void test_revalidator()
+{
+    auto &revalidator = Revalidator::instance();
+    assert(revalidator.begin("a"));
+    assert(!revalidator.begin("a"));
+    assert(revalidator.begin("b"));
+
+    revalidator.end("a", true);
+    revalidator.end("b", false);
+    revalidator.wait();
+
+    assert(revalidator.begin("a"));
+    revalidator.end("a", true);
+    assert(revalidator.str() == "[stale] served: 4 refreshed: 2 failed: 1");
+
+    std::cout << "test_revalidator passed!" << std::endl;
+}
+
+int main()
+{
+    test_ttl_by_frequency();
+    test_historic_data();
+    test_revalidator();
+
+    std::cout << "All tests passed!" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,293 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "../include/get.h"
+#include <iostream>
+#include <cassert>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+
+void test_response_growth()
+{
+    ResponseData data;
+    std::string piece(100, 'x');
+    size_t reallocations = 0;
+    size_t capacity = data.body.capacity();
+    for (int i = 0; i < 10000; ++i)
+    {
+        data.append(piece.data(), piece.size());
+        if (data.body.capacity() != capacity)
+        {
+            ++reallocations;
+            capacity = data.body.capacity();
+        }
+    }
+    assert(data.size() == 1000000 && data.decoded_bytes == 1000000);
+    assert(reallocations < 25); // doubling, not one per piece
+
+    std::string body = data.take();
+    assert(body.size() == 1000000);
+
+    // streaming only, nothing is buffered
+    ResponseData streamed;
+    size_t seen = 0;
+    streamed.keep_body = false;
+    streamed.on_data = [&](const char *, size_t n)
+    { seen += n; };
+    streamed.append(piece.data(), piece.size());
+    assert(seen == 100 && streamed.size() == 0);
+
+    std::cout << "test_response_growth passed!" << std::endl;
+}
+
+void test_response_reserve()
+{
+    auto header = [](ResponseData &data, std::string line)
+    {
+        return HeaderCallback(line.data(), 1, line.size(), &data);
+    };
+
+    ResponseData data;
+    std::string length = "Content-Length: 50000\r\n";
+    assert(header(data, length) == length.size());
+    assert(data.body.capacity() >= 50000);
+
+    // the hint is capped, a bogus length does not allocate it
+    ResponseData huge;
+    huge.reserve(ResponseData::max_reserve * 4);
+    assert(huge.body.capacity() >= ResponseData::max_reserve && huge.body.capacity() < ResponseData::max_reserve * 2);
+
+    // malformed and out of range values are ignored, so are other headers
+    ResponseData odd;
+    header(odd, "content-length: lots\r\n");
+    header(odd, "Content-Length: 99999999999999999999999\r\n");
+    header(odd, "Content-Type: 50000\r\n");
+    assert(odd.body.capacity() < 50000);
+
+    // without a body nothing is reserved
+    ResponseData streamed;
+    streamed.keep_body = false;
+    header(streamed, "Content-Length: 50000\r\n");
+    assert(streamed.body.capacity() < 50000);
+
+    // an error in the stream consumer aborts the transfer, take() rethrows it
+    ResponseData failing;
+    failing.on_data = [](const char *, size_t)
+    { throw std::runtime_error("parse error"); };
+    std::string piece = "abc";
+    assert(WriteCallback(piece.data(), 1, piece.size(), &failing) == 0);
+    bool thrown = false;
+    try
+    {
+        failing.take();
+    }
+    catch (const std::runtime_error &)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+
+    std::cout << "test_response_reserve passed!" << std::endl;
+}
+
+// every early failure reaches done once, on the calling thread
+void test_request_cb_early_errors()
+{
+    GetParams params;
+    params.url = "https://evds2.tcmb.gov.tr/service/evds/series=TP.DK.USD.A&type=json";
+
+    auto expect_error = [&](const Config &config)
+    {
+        size_t calls = 0;
+        bool failed = false;
+        get_request_cb(params, config, [&](std::exception_ptr error, std::string body)
+                       {
+                           ++calls;
+                           failed = error != nullptr && body.empty(); });
+        assert(calls == 1 && failed);
+    };
+
+    Config unknown;
+    unknown.cache = false;
+    unknown.transport = "carrier pigeon";
+    expect_error(unknown);
+
+    Config unconfirmed;
+    unconfirmed.cache = false;
+    unconfirmed.auto_confirm = false;
+    expect_error(unconfirmed);
+
+    Config priority;
+    priority.cache = false;
+    priority.priority = "urgent";
+    expect_error(priority);
+
+    std::cout << "test_request_cb_early_errors passed!" << std::endl;
+}
+
+// without an API key warm-up is skipped, the requests report the missing key
+void test_warm_up_without_key()
+{
+    unsetenv("EVDS_APIKEY");
+    unsetenv("EVDS_APIKEYS");
+
+    Config config;
+    config.test = true;
+    warm_up(config);
+
+    std::cout << "test_warm_up_without_key passed!" << std::endl;
+}
+
+static std::string gzip(const std::string &text)
+{
+    z_stream zs{};
+    deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&zs, text.size()), '\0');
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(text.data()));
+    zs.avail_in = static_cast<uInt>(text.size());
+    zs.next_out = reinterpret_cast<Bytef *>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+    deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return out;
+}
+
+// answers one request on 127.0.0.1 with a gzip body and keeps the request head
+class GzipServer
+{
+public:
+    explicit GzipServer(const std::string &body)
+    {
+        fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        bind(fd_, reinterpret_cast<sockaddr *>(&addr), len);
+        listen(fd_, 1);
+        getsockname(fd_, reinterpret_cast<sockaddr *>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+
+        thread_ = std::thread([this, body]
+                              {
+            int client = accept(fd_, nullptr, nullptr);
+            if (client < 0)
+                return;
+            char buffer[4096];
+            while (request_.find("\r\n\r\n") == std::string::npos)
+            {
+                ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+                if (n <= 0)
+                    break;
+                request_.append(buffer, n);
+            }
+            std::string reply = "HTTP/1.1 200 OK\r\nContent-Encoding: gzip\r\nContent-Length: " +
+                                std::to_string(body.size()) + "\r\n\r\n" + body;
+            send(client, reply.data(), reply.size(), 0);
+            close(client); });
+    }
+
+    ~GzipServer()
+    {
+        shutdown(fd_, SHUT_RDWR);
+        close(fd_);
+        if (thread_.joinable())
+            thread_.join();
+    }
+
+    std::string url() const
+    {
+        return "http://127.0.0.1:" + std::to_string(port_) + "/";
+    }
+
+    // after the transfer
+    std::string request()
+    {
+        thread_.join();
+        return request_;
+    }
+
+private:
+    int fd_ = -1;
+    int port_ = 0;
+    std::thread thread_;
+    std::string request_;
+};
+
+void test_compressed_transfer()
+{
+    std::string json = "{\"totalCount\":0,\"items\":[";
+    for (int i = 0; i < 200; ++i)
+        json += std::string(i ? "," : "") + "{\"Tarih\":\"01-01-2020\",\"TP_DK_USD_A\":\"5.9\"}";
+    json += "]}";
+    std::string wire = gzip(json);
+    GzipServer server(wire);
+
+    GetParams params;
+    params.url = server.url();
+    ResponseData chunk;
+
+    CURL *curl = curl_easy_init();
+    auto headers = configure_request(curl, params, chunk);
+    curl_easy_setopt(curl, CURLOPT_NOPROXY, "*");
+    assert(curl_easy_perform(curl) == CURLE_OK);
+
+    // ACCEPT_ENCODING "" offers what libcurl decodes, the body arrives decoded
+    std::string request = server.request();
+    assert(request.find("Accept-Encoding: ") != std::string::npos);
+    assert(request.find("gzip") != std::string::npos);
+    assert(chunk.take() == json);
+
+    // the stats count the compressed bytes on the wire
+    auto stats = transfer_stats(curl, chunk);
+    assert(stats.wire_bytes == static_cast<curl_off_t>(wire.size()));
+    assert(stats.decoded_bytes == json.size());
+    assert(stats.ratio() > 1.0);
+
+    curl_easy_cleanup(curl);
+    std::cout << "test_compressed_transfer passed!" << std::endl;
+}
+
+int main()
+{
+    test_response_growth();
+    test_response_reserve();
+    test_request_cb_early_errors();
+    test_warm_up_without_key();
+    test_compressed_transfer();
+
+    std::cout << "All tests passed!" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "../include/get_series.h"
+#include <iostream>
+#include <cassert>
+#include <filesystem>
+
+static std::string fixture_dir()
+{
+    return (std::filesystem::current_path() / "fixtures").string();
+}
+
+static Config replay_config(const std::string &start_date, const std::string &end_date)
+{
+    Config config;
+    config.transport = "replay";
+    config.fixture_dir = fixture_dir();
+    config.cache = true;
+    config.start_date = start_date;
+    config.end_date = end_date;
+    return config;
+}
+
+static std::string response(const std::vector<std::string> &dates, const std::string &column)
+{
+    std::string items;
+    for (size_t i = 0; i < dates.size(); ++i)
+    {
+        if (!items.empty())
+            items += ",";
+        items += "{\"Tarih\":\"" + dates[i] + "\",\"" + column + "\":\"" + std::to_string(i + 1) + "\",\"UNIXTIME\":{\"$numberLong\":\"1\"}}";
+    }
+    return "{\"totalCount\":" + std::to_string(dates.size()) + ",\"items\":[" + items + "]}";
+}
+
+// annual rows are not dd-mm-yyyy: the RangeStore skips them, the URL cache still has them
+void test_annual_cache_hit()
+{
+    Config config = replay_config("01-01-2019", "31-12-2021");
+    std::string url = UrlBuilder(Index("TP.ANNUAL.A"), config).get_url();
+
+    FixtureStore(fixture_dir()).save(url, response({"2019", "2020", "2021"}, "TP_ANNUAL_A"));
+    auto first = get_series("TP.ANNUAL.A", config);
+    assert(first.rows() == 3);
+
+    // a second fetch would fail now
+    std::filesystem::remove_all(fixture_dir());
+    auto second = get_series("TP.ANNUAL.A", config);
+    assert(second.rows() == 3);
+    assert(second.columns["TP_ANNUAL_A"] == first.columns["TP_ANNUAL_A"]);
+
+    std::cout << "test_annual_cache_hit passed!" << std::endl;
+}
+
+// monthly rows at the default frequency: the first chunk shows it, the window goes as one request
+void test_default_frequency_not_split()
+{
+    Config config = replay_config("01-01-2000", "31-12-2010");
+    config.cache = false;
+
+    std::vector<std::string> months;
+    for (int year = 2000; year <= 2010; ++year)
+        for (int month = 1; month <= 12; ++month)
+            months.push_back((month < 10 ? "01-0" : "01-") + std::to_string(month) + "-" + std::to_string(year));
+
+    Config first = config;
+    first.end_date = format_date(*parse_date(config.start_date) + std::chrono::days(chunk_days("default") - 1));
+    std::vector<std::string> early(months.begin(), months.begin() + 60);
+
+    FixtureStore fixtures(fixture_dir());
+    fixtures.save(UrlBuilder(Index("TP.MONTHLY.A"), first).get_url(), response(early, "TP_MONTHLY_A"));
+    fixtures.save(UrlBuilder(Index("TP.MONTHLY.A"), config).get_url(), response(months, "TP_MONTHLY_A"));
+
+    auto df = get_series("TP.MONTHLY.A", config);
+    assert(df.rows() == months.size());
+    assert(std::get<std::string>(df.columns["Tarih"].back()) == "01-12-2010");
+
+    std::filesystem::remove_all(fixture_dir());
+    std::cout << "test_default_frequency_not_split passed!" << std::endl;
+}
+
+// the second run asks only for the days after the stored range
+void test_incremental_delta()
+{
+    Config config = replay_config("01-01-2020", "10-01-2020");
+    config.incremental = true;
+
+    std::vector<std::string> days;
+    for (int day = 1; day <= 15; ++day)
+        days.push_back((day < 10 ? "0" : "") + std::to_string(day) + "-01-2020");
+
+    FixtureStore fixtures(fixture_dir());
+    fixtures.save(UrlBuilder(Index("TP.DAILY.A"), config).get_url(),
+                  response(std::vector<std::string>(days.begin(), days.begin() + 10), "TP_DAILY_A"));
+    auto first = get_series("TP.DAILY.A", config);
+    assert(first.rows() == 10);
+
+    // only the delta has a fixture: a request for the whole window would fail
+    std::filesystem::remove_all(fixture_dir());
+    Config later = config;
+    later.end_date = "15-01-2020";
+    Config delta = later;
+    delta.start_date = "11-01-2020";
+    fixtures.save(UrlBuilder(Index("TP.DAILY.A"), delta).get_url(),
+                  response(std::vector<std::string>(days.begin() + 10, days.end()), "TP_DAILY_A"));
+
+    auto second = get_series("TP.DAILY.A", later);
+    assert(second.rows() == 15);
+    assert(std::get<std::string>(second.columns["Tarih"].front()) == "01-01-2020");
+    assert(std::get<std::string>(second.columns["Tarih"].back()) == "15-01-2020");
+
+    std::filesystem::remove_all(fixture_dir());
+    std::cout << "test_incremental_delta passed!" << std::endl;
+}
+
+// without the cache nothing is stored, the window is fetched whole
+void test_incremental_without_cache()
+{
+    Config config = replay_config("01-01-2020", "03-01-2020");
+    config.incremental = true;
+    config.cache = false;
+
+    FixtureStore(fixture_dir()).save(UrlBuilder(Index("TP.NOCACHE.A"), config).get_url(),
+                                     response({"01-01-2020", "02-01-2020", "03-01-2020"}, "TP_NOCACHE_A"));
+    assert(get_series("TP.NOCACHE.A", config).rows() == 3);
+    assert(RangeStore::intervals(RangeStore::set_key("TP.NOCACHE.A", config)).empty());
+
+    std::filesystem::remove_all(fixture_dir());
+    std::cout << "test_incremental_without_cache passed!" << std::endl;
+}
+
+// a joiner only shares a fetch that gives up when it would
+void test_flight_key()
+{
+    Config config;
+    std::string key = "series=TP.DK.USD.A";
+    assert(flight_key(key, config) == flight_key(key, config));
+
+    Config sooner = config;
+    sooner.deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    assert(flight_key(key, sooner) != flight_key(key, config));
+
+    Config fewer = config;
+    fewer.retries = 0;
+    assert(flight_key(key, fewer) != flight_key(key, config));
+
+    std::cout << "test_flight_key passed!" << std::endl;
+}
+
+int main()
+{
+    // Cache::instance() writes to ./.caches
+    auto dir = std::filesystem::temp_directory_path() / "evds_test_get_series";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    std::filesystem::current_path(dir);
+
+    test_annual_cache_hit();
+    test_default_frequency_not_split();
+    test_incremental_delta();
+    test_incremental_without_cache();
+    test_flight_key();
+
+    std::cout << "All tests passed!" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,148 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "../include/json.h"
+#include <iostream>
+#include <cassert>
+
+static const std::string sample = R"({"totalCount":3,"items":[
+    {"Tarih":"01-01-2020","TP_DK_USD_A":"5.9","TP_DK_EUR_A":null,"UNIXTIME":{"$numberLong":"1577836800"}},
+    {"Tarih":"2020-2","TP_DK_USD_A":"6.01","TP_DK_EUR_A":"6.6","UNIXTIME":{"$numberLong":"1580515200"}},
+    {"Tarih":"2020-12","TP_DK_USD_A":"ab\"c}{","TP_DK_EUR_A":12,"UNIXTIME":{"$numberLong":"1583020800"}}
+]})";
+
+evds::DataFrame parse_dom(const std::string &body)
+{
+    evds::DataFrame df;
+    nlohmann::json parsed_json = nlohmann::json::parse(body);
+    for (const auto &item : parsed_json["items"])
+        evds::parse_json_line(item, df);
+    return df;
+}
+
+void assert_same(const evds::DataFrame &a, const evds::DataFrame &b)
+{
+    assert(a.columns.size() == b.columns.size());
+    for (const auto &[name, column] : a.columns)
+    {
+        assert(b.columns.count(name));
+        assert(b.columns.at(name) == column);
+    }
+}
+
+void test_stream_matches_dom()
+{
+    evds::ItemStreamParser parser;
+    parser.feed(sample);
+    parser.finish();
+
+    auto df = parser.take();
+    assert(df.columns.count("UNIXTIME") == 0);
+    assert(df.columns["Tarih"].size() == 3);
+    assert(std::get<std::string>(df.columns["Tarih"][1]) == "01-02-2020");
+    assert(std::holds_alternative<std::monostate>(df.columns["TP_DK_EUR_A"][0]));
+
+    assert_same(df, parse_dom(sample));
+
+    std::cout << "test_stream_matches_dom passed!" << std::endl;
+}
+
+void test_stream_in_pieces()
+{
+    auto expected = parse_dom(sample);
+
+    for (size_t piece : {1, 2, 7, 64})
+    {
+        evds::ItemStreamParser parser;
+        for (size_t i = 0; i < sample.size(); i += piece)
+            parser.feed(sample.data() + i, std::min(piece, sample.size() - i));
+        parser.finish();
+
+        assert_same(parser.take(), expected);
+    }
+
+    std::cout << "test_stream_in_pieces passed!" << std::endl;
+}
+
+void test_stream_incomplete()
+{
+    evds::ItemStreamParser parser;
+    parser.feed(sample.substr(0, sample.size() / 2));
+
+    bool thrown = false;
+    try
+    {
+        parser.finish();
+    }
+    catch (const std::runtime_error &)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+
+    thrown = false;
+    try
+    {
+        evds::ItemStreamParser html;
+        html.feed("<html>error</html>");
+    }
+    catch (const std::runtime_error &)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+
+    std::cout << "test_stream_incomplete passed!" << std::endl;
+}
+
+void test_frame_round_trip()
+{
+    auto df = parse_dom(sample);
+    auto body = evds::frame_to_items_json(df);
+
+    assert_same(df, parse_dom(body));
+
+    evds::ItemStreamParser parser;
+    parser.feed(body);
+    parser.finish();
+    assert_same(df, parser.take());
+
+    std::cout << "test_frame_round_trip passed!" << std::endl;
+}
+
+int main()
+{
+    test_stream_matches_dom();
+    test_stream_in_pieces();
+    test_stream_incomplete();
+    test_frame_round_trip();
+
+    std::cout << "All tests passed!" << std::endl;
+
+    return 0;
+}
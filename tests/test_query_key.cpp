@@ -0,0 +1,87 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "../include/query_key.h"
+#include "../include/url_builder.h"
+#include <iostream>
+#include <cassert>
+
+void test_murmur3_128()
+{
+    assert(evds::murmur3_128("").hex() == "00000000000000000000000000000000");
+    assert(evds::murmur3_128("The quick brown fox jumps over the lazy dog").hex() == "6c1b07bc7bbc4be347939ac4a93c437a");
+    assert(!(evds::murmur3_128("TP.DK.USD.A") == evds::murmur3_128("TP.DK.EUR.A")));
+
+    std::cout << "test_murmur3_128 passed!" << std::endl;
+}
+
+void test_series_order()
+{
+    std::string a = "https://evds2.tcmb.gov.tr/service/evds/series=TP.DK.USD.A-TP.DK.EUR.A&startDate=01-01-2020&endDate=31-12-2020&type=json";
+    std::string b = "https://evds2.tcmb.gov.tr/service/evds/series=TP.DK.EUR.A-TP.DK.USD.A&startDate=1-1-2020&endDate=31-12-2020&type=json";
+
+    assert(evds::canonical_query(a) == evds::canonical_query(b));
+    assert(evds::query_key(a) == evds::query_key(b));
+    assert(evds::canonical_query(a) ==
+           "https://evds2.tcmb.gov.tr/service/evds/endDate=31-12-2020&series=TP.DK.EUR.A::,TP.DK.USD.A::&startDate=01-01-2020&type=json");
+
+    std::cout << "test_series_order passed!" << std::endl;
+}
+
+void test_per_series_lists()
+{
+    std::string a = "https://evds2.tcmb.gov.tr/service/evds/series=B-A&startDate=01-01-2020&endDate=31-12-2020&frequency=5&aggregationTypes=avg-sum&formulas=0-1&type=json";
+    std::string b = "https://evds2.tcmb.gov.tr/service/evds/series=A-B&startDate=01-01-2020&endDate=31-12-2020&frequency=5&aggregationTypes=sum-avg&formulas=1-0&type=json";
+    std::string c = "https://evds2.tcmb.gov.tr/service/evds/series=A-B&startDate=01-01-2020&endDate=31-12-2020&frequency=5&aggregationTypes=avg-sum&formulas=0-1&type=json";
+
+    // formulas stay attached to their series
+    assert(evds::canonical_query(a) == evds::canonical_query(b));
+    assert(evds::canonical_query(a) != evds::canonical_query(c));
+
+    // whatever else differs keeps the keys apart
+    evds::Config config;
+    config.start_date = "01-01-2020";
+    config.end_date = "31-12-2020";
+    auto url = evds::UrlBuilder(evds::Index("TP.DK.USD.A"), config).get_url();
+    config.frequency = "monthly";
+    auto monthly = evds::UrlBuilder(evds::Index("TP.DK.USD.A"), config).get_url();
+    assert(evds::query_key(url) != evds::query_key(monthly));
+
+    std::cout << "test_per_series_lists passed!" << std::endl;
+}
+
+int main()
+{
+    test_murmur3_128();
+    test_series_order();
+    test_per_series_lists();
+
+    std::cout << "All tests passed!" << std::endl;
+
+    return 0;
+}
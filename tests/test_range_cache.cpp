@@ -0,0 +1,261 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "../include/range_cache.h"
+#include <iostream>
+#include <cassert>
+#include <filesystem>
+#include <thread>
+
+using namespace evds;
+
+static DateRange range(const std::string &start, const std::string &end)
+{
+    return DateRange{*parse_date(start), *parse_date(end)};
+}
+
+static bool same(const DateRange &a, const DateRange &b)
+{
+    return a.start == b.start && a.end == b.end;
+}
+
+void test_lookup_range()
+{
+    std::vector<DateRange> intervals = {range("01-01-2000", "31-12-2009"), range("01-01-2015", "31-12-2019")};
+
+    // contained
+    auto lookup = lookup_range(intervals, range("01-06-2003", "30-06-2004"));
+    assert(lookup.covering && same(*lookup.covering, intervals[0]));
+    assert(lookup.missing.empty());
+
+    // partial, the gap between the intervals and the tail are missing
+    lookup = lookup_range(intervals, range("01-01-2005", "31-12-2022"));
+    assert(!lookup.covering);
+    assert(lookup.touching.size() == 2);
+    assert(lookup.missing.size() == 2);
+    assert(same(lookup.missing[0], range("01-01-2010", "31-12-2014")));
+    assert(same(lookup.missing[1], range("01-01-2020", "31-12-2022")));
+
+    // disjoint
+    lookup = lookup_range(intervals, range("01-01-2011", "31-12-2012"));
+    assert(lookup.touching.empty());
+    assert(lookup.missing.size() == 1 && same(lookup.missing[0], range("01-01-2011", "31-12-2012")));
+
+    // adjacent intervals are merged but nothing of them is missing
+    lookup = lookup_range(intervals, range("01-01-2010", "31-12-2014"));
+    assert(!lookup.covering);
+    assert(lookup.touching.size() == 2);
+    assert(lookup.missing.size() == 1 && same(lookup.missing[0], range("01-01-2010", "31-12-2014")));
+
+    std::cout << "test_lookup_range passed!" << std::endl;
+}
+
+void test_cacheable_range()
+{
+    Config config;
+    config.start_date = "01-01-2020";
+    config.end_date = "31-12-2020";
+
+    config.frequency = "daily";
+    assert(cacheable_range(config));
+    config.formulas = "pc";
+    assert(!cacheable_range(config));
+    config.formulas = "level";
+    assert(cacheable_range(config));
+    config.frequency = "monthly";
+    assert(!cacheable_range(config));
+
+    config.frequency = "business";
+    config.end_date = "2020";
+    assert(!cacheable_range(config));
+
+    std::cout << "test_cacheable_range passed!" << std::endl;
+}
+
+void test_column_series()
+{
+    DataFrame df;
+    df.add_value("Tarih", std::string("01-01-2020"));
+    df.add_value("TP_DK_USD_A", 1.0);
+    df.add_value("TP_DK_USD_A-1", 0.1);
+
+    auto codes = column_series(df);
+    assert(codes.size() == 1);
+    assert(codes.at("TP.DK.USD.A") == "TP_DK_USD_A");
+
+    std::cout << "test_column_series passed!" << std::endl;
+}
+
+static DataFrame daily_frame(const std::string &start, int days)
+{
+    DataFrame df;
+    Days day = *parse_date(start);
+    for (int i = 0; i < days; ++i, day += std::chrono::days(1))
+    {
+        df.columns["Tarih"].push_back(format_date(day));
+        df.columns["TP_DK_USD_A"].push_back(static_cast<double>(i));
+    }
+    return df;
+}
+
+void test_range_store()
+{
+    std::string set = RangeStore::set_key("https://evds2.tcmb.gov.tr/service/evds/series=TP.DK.USD.A&startDate=01-01-2020&endDate=31-01-2020&type=json");
+    assert(set == RangeStore::set_key("https://evds2.tcmb.gov.tr/service/evds/series=TP.DK.USD.A&startDate=05-05-2021&endDate=06-05-2021&type=json"));
+    assert(RangeStore::intervals(set).empty());
+
+    RangeStore::replace(set, {}, range("01-01-2020", "31-01-2020"), daily_frame("01-01-2020", 31), EntryMeta::now());
+    RangeStore::replace(set, {}, range("01-03-2020", "31-03-2020"), daily_frame("01-03-2020", 31), EntryMeta::now());
+    assert(RangeStore::intervals(set).size() == 2);
+
+    // February joins both into one interval
+    auto wanted = range("01-02-2020", "29-02-2020");
+    auto lookup = lookup_range(RangeStore::intervals(set), wanted);
+    assert(lookup.touching.size() == 2);
+
+    std::vector<DataFrame> parts = {daily_frame("01-02-2020", 29)};
+    for (const auto &interval : lookup.touching)
+        parts.push_back(*RangeStore::load(set, interval));
+    RangeStore::replace(set, lookup.touching, range("01-01-2020", "31-03-2020"), stitch_frames(parts), EntryMeta::now());
+
+    auto intervals = RangeStore::intervals(set);
+    assert(intervals.size() == 1 && same(intervals[0], range("01-01-2020", "31-03-2020")));
+    assert(!RangeStore::load(set, range("01-01-2020", "31-01-2020")));
+
+    auto df = RangeStore::load(set, intervals[0]);
+    assert(df && df->rows() == 91);
+
+    // never past yesterday
+    Days yesterday = today() - std::chrono::days(1);
+    std::string recent = format_date(yesterday - std::chrono::days(2));
+    RangeStore::replace(set, {}, DateRange{yesterday - std::chrono::days(2), yesterday + std::chrono::days(5)}, daily_frame(recent, 8), EntryMeta::now());
+    intervals = RangeStore::intervals(set);
+    assert(intervals.size() == 2 && intervals[1].end == yesterday);
+    assert(RangeStore::load(set, intervals[1])->rows() == 3);
+
+    std::cout << "test_range_store passed!" << std::endl;
+}
+
+void test_range_store_merge()
+{
+    Config config;
+    std::string gbp = RangeStore::set_key("TP.DK.GBP.A", config);
+    assert(gbp != RangeStore::set_key("TP.DK.EUR.A", config));
+    assert(gbp == RangeStore::set_key(UrlBuilder(Index("TP.DK.GBP.A"), config).get_url()));
+
+    RangeStore::merge(gbp, range("01-01-2020", "31-01-2020"), daily_frame("01-01-2020", 31), EntryMeta::now());
+    RangeStore::merge(gbp, range("15-01-2020", "15-02-2020"), daily_frame("15-01-2020", 32), EntryMeta::now());
+
+    auto intervals = RangeStore::intervals(gbp);
+    assert(intervals.size() == 1 && same(intervals[0], range("01-01-2020", "15-02-2020")));
+    assert(RangeStore::load(gbp, intervals[0])->rows() == 46);
+
+    // merged rows are as old as the oldest interval, a contained one is superseded
+    EntryMeta old = EntryMeta::now();
+    old.fetched_at -= 10 * 86400;
+    RangeStore::merge(gbp, range("16-02-2020", "29-02-2020"), daily_frame("16-02-2020", 14), old);
+    RangeStore::merge(gbp, range("01-03-2020", "31-03-2020"), daily_frame("01-03-2020", 31), EntryMeta::now());
+    intervals = RangeStore::intervals(gbp);
+    assert(intervals.size() == 1 && RangeStore::meta(gbp, intervals[0])->fetched_at == old.fetched_at);
+    assert(RangeStore::meta(gbp, intervals[0])->last_observation == static_cast<int32_t>(parse_date("31-03-2020")->time_since_epoch().count()));
+
+    RangeStore::merge(gbp, range("01-01-2020", "31-03-2020"), daily_frame("01-01-2020", 91), EntryMeta::now());
+    assert(!is_stale(*RangeStore::meta(gbp, RangeStore::intervals(gbp)[0])));
+
+    // rows that cannot be sliced by date are not stored
+    DataFrame quarterly;
+    quarterly.add_value("Tarih", std::string("2020-Q1"));
+    RangeStore::merge(gbp, range("01-06-2020", "30-06-2020"), quarterly, EntryMeta::now());
+    assert(RangeStore::intervals(gbp).size() == 1);
+
+    std::cout << "test_range_store_merge passed!" << std::endl;
+}
+
+void test_concurrent_merge()
+{
+    Config config;
+    std::string chf = RangeStore::set_key("TP.DK.CHF.A", config);
+
+    // adjacent blocks merged at the same time end up as one interval
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i)
+    {
+        threads.emplace_back([&chf, i]
+                             {
+            Days start = *parse_date("01-01-2020") + std::chrono::days(10 * i);
+            DateRange block{start, start + std::chrono::days(9)};
+            RangeStore::merge(chf, block, daily_frame(format_date(start), 10), EntryMeta::now()); });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    auto intervals = RangeStore::intervals(chf);
+    assert(intervals.size() == 1 && same(intervals[0], range("01-01-2020", "20-03-2020")));
+    assert(RangeStore::load(chf, intervals[0])->rows() == 80);
+
+    std::cout << "test_concurrent_merge passed!" << std::endl;
+}
+
+void test_record_after_lookup()
+{
+    Config config;
+    std::string jpy = RangeStore::set_key("TP.DK.JPY.A", config);
+    RangeStore::merge(jpy, range("01-01-2020", "31-01-2020"), daily_frame("01-01-2020", 31), EntryMeta::now());
+
+    // two fetches saw only January; the longer one records first
+    DataFrame january = *RangeStore::load(jpy, range("01-01-2020", "31-01-2020"));
+    RangeStore::record(jpy, range("01-01-2020", "29-02-2020"), stitch_frames({daily_frame("01-02-2020", 29), january}), EntryMeta::now());
+    RangeStore::record(jpy, range("01-01-2020", "15-02-2020"), stitch_frames({daily_frame("01-02-2020", 15), january}), EntryMeta::now());
+
+    auto intervals = RangeStore::intervals(jpy);
+    assert(intervals.size() == 1 && same(intervals[0], range("01-01-2020", "29-02-2020")));
+    assert(RangeStore::load(jpy, intervals[0])->rows() == 60);
+
+    std::cout << "test_record_after_lookup passed!" << std::endl;
+}
+
+int main()
+{
+    // the store goes through Cache::instance(), which writes to ./.caches
+    auto dir = std::filesystem::temp_directory_path() / "evds_test_range_cache";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    std::filesystem::current_path(dir);
+
+    test_lookup_range();
+    test_cacheable_range();
+    test_column_series();
+    test_range_store();
+    test_range_store_merge();
+    test_concurrent_merge();
+    test_record_after_lookup();
+
+    std::cout << "All tests passed!" << std::endl;
+
+    return 0;
+}
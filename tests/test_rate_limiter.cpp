@@ -0,0 +1,165 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "../include/key_pool.h"
+#include <iostream>
+#include <cassert>
+
+void test_classify_outcome()
+{
+    assert(evds::classify_outcome(true, false, 200) == evds::Outcome::ok);
+    assert(evds::classify_outcome(true, false, 404) == evds::Outcome::ok);
+    assert(evds::classify_outcome(true, false, 429) == evds::Outcome::throttled);
+    assert(evds::classify_outcome(true, false, 503) == evds::Outcome::throttled);
+    assert(evds::classify_outcome(true, false, 500) == evds::Outcome::server_error);
+    assert(evds::classify_outcome(false, true, 0) == evds::Outcome::timeout);
+    assert(evds::classify_outcome(false, false, 0) == evds::Outcome::failed);
+
+    std::cout << "test_classify_outcome passed!" << std::endl;
+}
+
+void test_aimd_limit()
+{
+    evds::Config config;
+    config.rate_limit = 0;
+    config.jobs = 2;
+    config.max_jobs = 8;
+
+    evds::RateLimiter limiter;
+    limiter.configure(config);
+
+    assert(limiter.try_acquire());
+    assert(limiter.try_acquire());
+    assert(!limiter.try_acquire());
+
+    // two healthy responses per slot grow the limit by one
+    limiter.release(evds::Outcome::ok, 10);
+    limiter.release(evds::Outcome::ok, 10);
+    assert(limiter.metrics().limit == 2);
+    for (int i = 0; i < 3; ++i)
+    {
+        assert(limiter.try_acquire());
+        limiter.release(evds::Outcome::ok, 10);
+    }
+    assert(limiter.metrics().limit == 3);
+
+    limiter.release(evds::Outcome::throttled, 10);
+    assert(limiter.metrics().limit == 1);
+    assert(limiter.metrics().throttled == 1);
+
+    std::cout << "test_aimd_limit passed!" << std::endl;
+}
+
+void test_jobs_cap_without_max_jobs()
+{
+    evds::Config config;
+    config.rate_limit = 0;
+    config.jobs = 2;
+    assert(evds::max_jobs(config) == 2);
+
+    evds::RateLimiter limiter;
+    limiter.configure(config);
+
+    for (int i = 0; i < 20; ++i)
+    {
+        assert(limiter.try_acquire());
+        limiter.release(evds::Outcome::ok, 10);
+    }
+    assert(limiter.metrics().limit == 2);
+
+    config.max_jobs = 6;
+    assert(evds::max_jobs(config) == 6);
+
+    std::cout << "test_jobs_cap_without_max_jobs passed!" << std::endl;
+}
+
+void test_token_bucket()
+{
+    evds::Config config;
+    config.rate_limit = 1;
+    config.burst = 2;
+    config.jobs = 16;
+    config.max_jobs = 16;
+
+    evds::RateLimiter limiter;
+    limiter.configure(config);
+
+    assert(limiter.try_acquire());
+    assert(limiter.try_acquire());
+    assert(!limiter.try_acquire());
+    assert(limiter.wait_hint().count() > 0);
+    assert(limiter.wait_hint().count() <= 1001);
+
+    std::cout << "test_token_bucket passed!" << std::endl;
+}
+
+void test_key_pool()
+{
+    evds::Config config;
+    config.rate_limit = 0;
+    config.jobs = 1;
+    config.max_jobs = 1;
+
+    auto &pool = evds::KeyPool::instance();
+    pool.configure(config, {"a", "b"});
+    assert(pool.size() == 2);
+
+    // round robin, one slot per key
+    auto first = pool.try_acquire();
+    auto second = pool.try_acquire();
+    assert(first && second && *first != *second);
+    assert(!pool.try_acquire());
+    assert(pool.key(*first) == "a" && pool.key(*second) == "b");
+
+    // a 429 only slows down the key that got it
+    pool.release(*first, evds::Outcome::ok, 10);
+    auto again = pool.try_acquire();
+    assert(again && *again == *first);
+    pool.release(*again, evds::Outcome::throttled, 10);
+    pool.release(*second, evds::Outcome::ok, 10);
+
+    std::string metrics = pool.metrics_str();
+    assert(metrics.find("[rate] key 1/2") != std::string::npos);
+    assert(metrics.find("[rate] key 2/2") != std::string::npos);
+    assert(metrics.find("throttled: 1") != std::string::npos);
+    assert(metrics.find("throttled: 0") != std::string::npos);
+
+    std::cout << "test_key_pool passed!" << std::endl;
+}
+
+int main()
+{
+    test_classify_outcome();
+    test_aimd_limit();
+    test_jobs_cap_without_max_jobs();
+    test_token_bucket();
+    test_key_pool();
+
+    std::cout << "All tests passed!" << std::endl;
+
+    return 0;
+}
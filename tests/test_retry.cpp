@@ -0,0 +1,113 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "../include/retry.h"
+#include <iostream>
+#include <cassert>
+
+void test_transient_errors()
+{
+    assert(evds::TransferError("", CURLE_OPERATION_TIMEDOUT, 0).transient());
+    assert(evds::TransferError("", CURLE_COULDNT_CONNECT, 0).transient());
+    assert(evds::TransferError("", CURLE_HTTP_RETURNED_ERROR, 429).transient());
+    assert(evds::TransferError("", CURLE_HTTP_RETURNED_ERROR, 502).transient());
+    assert(!evds::TransferError("", CURLE_HTTP_RETURNED_ERROR, 404).transient());
+    assert(!evds::TransferError("", CURLE_URL_MALFORMAT, 0).transient());
+
+    std::cout << "test_transient_errors passed!" << std::endl;
+}
+
+void test_backoff_delay()
+{
+    evds::Config config;
+    config.retries = 2;
+    config.retry_base_ms = 100;
+    config.retry_max_ms = 300;
+
+    evds::RetryPolicy policy(config);
+    assert(policy.allows(1));
+    assert(policy.allows(2));
+    assert(!policy.allows(3));
+
+    for (int i = 0; i < 100; ++i)
+    {
+        assert(policy.delay(1).count() <= 100);
+        assert(policy.delay(2).count() <= 200);
+        assert(policy.delay(5).count() <= 300);
+    }
+
+    std::cout << "test_backoff_delay passed!" << std::endl;
+}
+
+void test_latency_percentile()
+{
+    auto &tracker = evds::LatencyTracker::instance();
+    tracker.clear();
+
+    for (int i = 1; i <= 19; ++i)
+        tracker.record(i);
+    assert(!tracker.percentile(0.95));
+
+    tracker.record(20);
+    assert(tracker.percentile(0.95) == 19.0);
+    assert(tracker.percentile(0.5) == 10.0);
+
+    std::cout << "test_latency_percentile passed!" << std::endl;
+}
+
+void test_deadlines()
+{
+    evds::Config config;
+    assert(evds::request_deadline(config) == evds::Deadline::max());
+    assert(evds::attempt_timeout_ms(5000, evds::Deadline::max()) == 5000);
+
+    config.deadline_ms = 1000;
+    auto deadline = evds::request_deadline(config);
+    assert(!evds::expired(deadline));
+    assert(evds::attempt_timeout_ms(5000, deadline) <= 1000);
+    assert(evds::attempt_timeout_ms(0, deadline) <= 1000);
+    assert(evds::attempt_timeout_ms(200, deadline) == 200);
+
+    // the earlier of the run's deadline and deadline_ms wins
+    config.deadline = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+    assert(evds::expired(evds::request_deadline(config)));
+    assert(evds::attempt_timeout_ms(5000, config.deadline) == 1);
+
+    std::cout << "test_deadlines passed!" << std::endl;
+}
+
+int main()
+{
+    test_transient_errors();
+    test_backoff_delay();
+    test_latency_percentile();
+    test_deadlines();
+
+    std::cout << "All tests passed!" << std::endl;
+
+    return 0;
+}
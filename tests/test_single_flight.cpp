@@ -0,0 +1,88 @@
+/*
+ * evdscpp: An open-source data wrapper for accessing the EVDS API.
+ * Author: Sermet Pekin
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2024 Sermet Pekin
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "../include/single_flight.h"
+#include <iostream>
+#include <cassert>
+#include <stdexcept>
+
+void test_followers_share_result()
+{
+    auto &flights = evds::SingleFlight<int>::instance();
+
+    std::vector<int> seen;
+    auto record = [&seen](std::exception_ptr error, int value)
+    {
+        assert(!error);
+        seen.push_back(value);
+    };
+
+    assert(flights.join("a", record));
+    assert(!flights.join("a", record));
+    assert(flights.join("b", record));
+    assert(flights.shared() == 1);
+
+    flights.complete("a", nullptr, 7);
+    assert((seen == std::vector<int>{7, 7}));
+
+    // finished flights are forgotten, the next caller leads again
+    assert(flights.join("a", record));
+    flights.complete("a", nullptr, 8);
+    flights.complete("b", nullptr, 9);
+    assert((seen == std::vector<int>{7, 7, 8, 9}));
+
+    std::cout << "test_followers_share_result passed!" << std::endl;
+}
+
+void test_errors_reach_everyone()
+{
+    auto &flights = evds::SingleFlight<std::string>::instance();
+
+    int failures = 0;
+    auto record = [&failures](std::exception_ptr error, std::string)
+    {
+        if (error)
+            ++failures;
+    };
+
+    assert(flights.join("x", record));
+    assert(!flights.join("x", record));
+    flights.complete("x", std::make_exception_ptr(std::runtime_error("boom")), "");
+    assert(failures == 2);
+
+    std::cout << "test_errors_reach_everyone passed!" << std::endl;
+}
+
+int main()
+{
+    test_followers_share_result();
+    test_errors_reach_everyone();
+
+    std::cout << "All tests passed!" << std::endl;
+
+    return 0;
+}